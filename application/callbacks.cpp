@@ -63,15 +63,41 @@ void Application::settings_cb(Fl_Widget *w, void *data)
 
     if (app->settingsDlg == nullptr) {
         app->settingsDlg = new SettingsDialog(app->x() + MODAL_WND_POS, app->y() + MODAL_WND_POS,
-                                              XLARGE_SPACE + MEDIUM_SPACE, LARGE_SPACE + MEDIUM_SPACE, "Settings", app);
+                                              XLARGE_SPACE + LARGE_SPACE + MEDIUM_SPACE + SMALL_SPACE, LARGE_SPACE * 2 + SMALL_SPACE * 2 + TINY_SPACE, "Settings", app);
     }
 
+    // Show the current history memory use and device latency.
+    app->settingsDlg->updateHistoryUsage();
+    app->settingsDlg->updateLatency();
+
     if (app->settingsDlg->runModal() == DIALOG_OK) {
         auto config = app->loadConfig(CONFIG_FILENAME);
         config.backend = app->settingsDlg->getBackend().text();
         config.outputDevice = app->settingsDlg->getOutput().text();
         config.inputDevice = app->settingsDlg->getInput().text();
+        config.historyBudget = static_cast<unsigned int>(app->settingsDlg->getHistoryBudget().value());
+        config.nonDestructiveEditing = app->settingsDlg->getNonDestructive().value();
+        config.resamplerQuality = static_cast<unsigned int>(app->settingsDlg->getResamplerQuality().value());
+        config.recordToDisk = app->settingsDlg->getRecordToDisk().value();
+        config.captureWakeup = static_cast<unsigned int>(app->settingsDlg->getCaptureWakeup().value());
+
+        // The devices have to be initialized again for the new settings to apply.
+        const auto& current = app->getEngine().getDeviceSettings();
+        bool restart = current.sampleRate != app->settingsDlg->getSampleRate() ||
+                       current.periodSize != app->settingsDlg->getPeriodSize() ||
+                       current.periodCount != app->settingsDlg->getPeriodCount() ||
+                       current.lowLatency != (app->settingsDlg->getPerformanceProfile() != "conservative");
+
+        config.sampleRate = app->settingsDlg->getSampleRate();
+        config.periodSize = app->settingsDlg->getPeriodSize();
+        config.periodCount = app->settingsDlg->getPeriodCount();
+        config.performanceProfile = app->settingsDlg->getPerformanceProfile();
         app->saveConfig(config, CONFIG_FILENAME);
+        app->setHistoryBudget(config.historyBudget);
+
+        if (restart) {
+            app->restartDevices();
+        }
     }
 }
 
@@ -144,3 +170,29 @@ void Application::time_cb(void *data)
 
 }
 
+/*
+ * Displays the load of the audio callbacks over the last interval, as well as the
+ * number of late callbacks and capture overruns since the devices have been initialized.
+ */
+void Application::dsp_load_cb(void* data)
+{
+    Application* app = (Application*) data;
+    CallbackStats::Snapshot stats = app->getEngine().getCallbackStats();
+    const CallbackStats::Snapshot& last = app->lastCallbackStats;
+
+    uint64_t budget = stats.totalBudget >= last.totalBudget ? stats.totalBudget - last.totalBudget : 0;
+    double load = budget ? 100.0 * (stats.totalTime - last.totalTime) / budget : 0.0;
+    bool xrun = stats.lateCallbacks > last.lateCallbacks || stats.overruns > last.overruns;
+
+    char label[128];
+    snprintf(label, sizeof(label), "DSP %.0f %% (peak %.0f %%)\nLate %llu  Overruns %llu", load, stats.peakLoad,
+             (unsigned long long) stats.lateCallbacks, (unsigned long long) stats.overruns);
+    app->dspLoadLabel = label;
+    app->dspLoad->label(app->dspLoadLabel.c_str());
+    // Highlight the xruns which just occurred.
+    app->dspLoad->labelcolor(xrun ? FL_RED : FL_FOREGROUND_COLOR);
+    app->dspLoad->redraw();
+    app->lastCallbackStats = stats;
+
+    Fl::repeat_timeout(0.5, dsp_load_cb, data);
+}
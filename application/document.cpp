@@ -7,6 +7,9 @@ void Application::addDocument(TrackOptions options)
 {
     // Height of tab label area.
     const int tabBarHeight = SMALL_SPACE; 
+    auto config = loadConfig(CONFIG_FILENAME);
+    options.nonDestructive = config.nonDestructiveEditing;
+    options.resamplerQuality = static_cast<Resampler::Quality>(config.resamplerQuality);
 
     // Create the group at the correct position relative to the tabs widget
     tabs->begin();
@@ -64,6 +67,9 @@ void Application::addDocument(TrackOptions options)
         tabs->resizable(doc);
     }
 
+    // Limit the memory taken by the edit history.
+    doc->getAudioHistory().setMemoryBudget(static_cast<size_t>(config.historyBudget) << 20);
+
     // Keep track of this document
     // documents now owns data (ie: move).
     documents.push_back(doc);
@@ -117,6 +123,29 @@ Document& Application::getActiveDocument()
     return *document;
 }
 
+/*
+ * Applies the given history memory budget (in MB) to all the documents.
+ */
+void Application::setHistoryBudget(unsigned int megabytes)
+{
+    for (size_t i = 0; i < documents.size(); i++) {
+        documents[i]->getAudioHistory().setMemoryBudget(static_cast<size_t>(megabytes) << 20);
+    }
+}
+
+/*
+ * Returns the memory and disk space (in bytes) taken by the edit history of all the documents.
+ */
+void Application::getHistoryUsage(size_t& memory, size_t& disk) const
+{
+    memory = disk = 0;
+
+    for (size_t i = 0; i < documents.size(); i++) {
+        memory += documents[i]->getAudioHistory().getMemoryUsage();
+        disk += documents[i]->getAudioHistory().getSpilledSize();
+    }
+}
+
 Document& Application::getDocumentByTrackId(unsigned int trackId)
 {
     for (size_t i = 0; i < documents.size(); i++) {
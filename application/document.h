@@ -3,6 +3,11 @@
 
 #include <filesystem>
 #include <FL/Fl_Scrollbar.H>
+#include <FL/Fl_Progress.H>
+#include <FL/Fl_Button.H>
+#include <FL/Fl_Light_Button.H>
+#include <FL/Fl_Value_Slider.H>
+#include <cmath>
 #include "../audio/track.h"
 #include "../audio/edit/history.h"
 using AudioHistory = audio::edit::History;
@@ -23,6 +28,62 @@ class Document : public Fl_Group {
         // File name and extension associated to the track.
         std::string fileName;
         std::string extension;
+        // Shown while the audio file is loading.
+        Fl_Progress* progress = nullptr;
+        Fl_Button* cancelBtn = nullptr;
+        // Mixer settings of the track.
+        Fl_Value_Slider* gainSlider = nullptr;
+        Fl_Value_Slider* panSlider = nullptr;
+        Fl_Light_Button* muteBtn = nullptr;
+        Fl_Light_Button* soloBtn = nullptr;
+
+        /*
+         * Creates the gain, pan, mute and solo controls on the right, below the scrollbar.
+         */
+        void renderMixerControls(int y) {
+            int h = SMALL_SPACE / 2;
+            int buttonWidth = SMALL_SPACE + TINY_SPACE;
+            int x = xPos + width - buttonWidth;
+
+            soloBtn = new Fl_Light_Button(x, y, buttonWidth, h, "Solo");
+            x -= buttonWidth + TINY_SPACE;
+            muteBtn = new Fl_Light_Button(x, y, buttonWidth, h, "Mute");
+            x -= MEDIUM_SPACE + TINY_SPACE;
+            panSlider = new Fl_Value_Slider(x, y, MEDIUM_SPACE, h, "Pan");
+            x -= LARGE_SPACE + SMALL_SPACE;
+            gainSlider = new Fl_Value_Slider(x, y, LARGE_SPACE, h, "Gain (dB)");
+
+            // From -60 dB (ie: silence) to +12 dB.
+            gainSlider->type(FL_HOR_NICE_SLIDER);
+            gainSlider->align(FL_ALIGN_LEFT);
+            gainSlider->bounds(-60.0, 12.0);
+            gainSlider->step(0.5);
+            gainSlider->value(0.0);
+            gainSlider->callback([](Fl_Widget* w, void* data) {
+                double db = ((Fl_Value_Slider*)w)->value();
+                ((Document*)data)->getTrack().setGain(db <= -60.0 ? 0.0f : static_cast<float>(std::pow(10.0, db / 20.0)));
+            }, this);
+
+            // From fully left (-100) to fully right (100).
+            panSlider->type(FL_HOR_NICE_SLIDER);
+            panSlider->align(FL_ALIGN_LEFT);
+            panSlider->bounds(-100.0, 100.0);
+            panSlider->step(1.0);
+            panSlider->value(0.0);
+            panSlider->callback([](Fl_Widget* w, void* data) {
+                ((Document*)data)->getTrack().setPan(static_cast<float>(((Fl_Value_Slider*)w)->value() / 100.0));
+            }, this);
+
+            muteBtn->clear_visible_focus();
+            muteBtn->callback([](Fl_Widget* w, void* data) {
+                ((Document*)data)->getTrack().setMuted(((Fl_Light_Button*)w)->value());
+            }, this);
+
+            soloBtn->clear_visible_focus();
+            soloBtn->callback([](Fl_Widget* w, void* data) {
+                ((Document*)data)->getTrack().setSoloed(((Fl_Light_Button*)w)->value());
+            }, this);
+        }
 
         void renderTrackWaveform() {
             Track& track = engine.getTrack(trackId);
@@ -46,7 +107,8 @@ class Document : public Fl_Group {
             scrollbar->callback([](Fl_Widget* w, void* data) {
                 auto* sb = (Fl_Scrollbar*)w;
                 auto* wf = (Waveform*)data;
-                wf->setScrollOffset(sb->value());
+                // The integer value of the scrollbar would overflow past 2^31 samples.
+                wf->setScrollOffset(static_cast<size_t>(sb->Fl_Valuator::value()));
             }, &track.getWaveform());
 
             track.getWaveform().setScrollbar(scrollbar);
@@ -55,6 +117,27 @@ class Document : public Fl_Group {
             Fl_Box* resize_box = new Fl_Box(wf_x, wf_y + MARKING_AREA_HEIGHT, wf_w, SCROLLBAR_HEIGHT + MARKING_AREA_HEIGHT);
             this->resizable(resize_box);
 
+            renderMixerControls(wf_y + wf_h + SCROLLBAR_MARGIN + SCROLLBAR_HEIGHT + TINY_SPACE);
+
+            // The audio file is decoded in background.
+            if (track.isLoading()) {
+                int py = wf_y + wf_h + SCROLLBAR_MARGIN + SCROLLBAR_HEIGHT + TINY_SPACE;
+                progress = new Fl_Progress(wf_x, py, XLARGE_SPACE, SMALL_SPACE / 2, "Loading...");
+                progress->minimum(0.0f);
+                progress->maximum(1.0f);
+                progress->value(0.0f);
+                progress->selection_color(FL_GREEN);
+
+                cancelBtn = new Fl_Button(wf_x + XLARGE_SPACE + TINY_SPACE, py, BUTTON_WIDTH, SMALL_SPACE / 2, "Cancel");
+                cancelBtn->clear_visible_focus();
+                cancelBtn->callback([](Fl_Widget* w, void* data) {
+                    auto* doc = (Document*)data;
+                    doc->getTrack().cancelLoading();
+                }, this);
+
+                Fl::add_timeout(0.1, loading_cb, this);
+            }
+
             // Done adding children.
             end();
 
@@ -62,6 +145,43 @@ class Document : public Fl_Group {
             track.getWaveform().redraw();
         }
 
+        /*
+         * Draws the samples decoded so far and updates the progress bar until loading is over.
+         */
+        static void loading_cb(void* data) {
+            auto* doc = (Document*)data;
+            Track& track = doc->getTrack();
+            auto& waveform = track.getWaveform();
+
+            if (waveform.pullDecodedSamples()) {
+                waveform.redraw();
+            }
+
+            if (track.isLoading()) {
+                doc->progress->value(track.getLoadingProgress());
+                Fl::repeat_timeout(0.1, loading_cb, data);
+                return;
+            }
+
+            size_t previousCount = track.getFrameCount();
+            track.finishLoading();
+
+            // Loading has been cancelled (or the file is shorter than expected).
+            if (track.getFrameCount() != previousCount) {
+                waveform.setSamples();
+            }
+            else {
+                // Get the very last decoded samples.
+                waveform.pullDecodedSamples();
+                // Next time the file is opened its waveform is drawn at once.
+                waveform.savePeakCache();
+            }
+
+            doc->progress->hide();
+            doc->cancelBtn->hide();
+            waveform.redraw();
+        }
+
     public:
 
         Document(int X, int Y, int W, int H, Engine& e, TrackOptions options)
@@ -75,6 +195,8 @@ class Document : public Fl_Group {
 
             // Create a new track.
             auto track = std::make_unique<Track>(engine);
+            track->setNonDestructive(options.nonDestructive);
+            track->setResamplerQuality(options.resamplerQuality);
 
             // Load the given audio file.
             if (options.filepath != nullptr) {
@@ -100,9 +222,19 @@ class Document : public Fl_Group {
             renderTrackWaveform();
         }
 
+        ~Document() {
+            // Stops the history compressor as well.
+            delete audioHistory;
+        }
+
         Track& getTrack() { return engine.getTrack(trackId); }
         unsigned int getTrackId() const { return trackId; }
-        void removeTrack() { engine.removeTrack(trackId); }
+        void removeTrack() {
+            // Stop drawing the file being loaded.
+            Fl::remove_timeout(loading_cb, this);
+            engine.removeTrack(trackId);
+        }
+
         bool isChanged() const { return changed; }
         bool isNew() const { return created; }
         std::string getFileName() const { return fileName; }
@@ -7,6 +7,16 @@ void Application::saveConfig(const AppConfig& config, const std::string& filenam
     j["backend"] = config.backend;
     j["outputDevice"] = config.outputDevice;
     j["inputDevice"] = config.inputDevice;
+    j["historyBudget"] = config.historyBudget;
+    j["nonDestructiveEditing"] = config.nonDestructiveEditing;
+    j["resamplerQuality"] = config.resamplerQuality;
+    j["sampleRate"] = config.sampleRate;
+    j["periodSize"] = config.periodSize;
+    j["periodCount"] = config.periodCount;
+    j["performanceProfile"] = config.performanceProfile;
+    j["recordToDisk"] = config.recordToDisk;
+    j["recordingDirectory"] = config.recordingDirectory;
+    j["captureWakeup"] = config.captureWakeup;
     //j["volume"] = config.volume;
 
     std::ofstream file(filename);
@@ -37,6 +47,16 @@ Application::AppConfig Application::loadConfig(const std::string& filename)
         config.backend = j.value("backend", "");
         config.outputDevice = j.value("outputDevice", "");
         config.inputDevice = j.value("inputDevice", "");
+        config.historyBudget = j.value("historyBudget", HISTORY_MEMORY_BUDGET);
+        config.nonDestructiveEditing = j.value("nonDestructiveEditing", false);
+        config.resamplerQuality = std::min(j.value("resamplerQuality", 1u), 2u);
+        config.sampleRate = j.value("sampleRate", 44100u);
+        config.periodSize = j.value("periodSize", 0u);
+        config.periodCount = j.value("periodCount", 0u);
+        config.performanceProfile = j.value("performanceProfile", "low latency");
+        config.recordToDisk = j.value("recordToDisk", false);
+        config.recordingDirectory = j.value("recordingDirectory", RECORDINGS_DIRECTORY);
+        config.captureWakeup = std::clamp(j.value("captureWakeup", CAPTURE_WAKEUP_INTERVAL), 1u, 1000u);
         //config.volume = j.value("volume", "0");
     }
     catch (const json::exception& e) {
@@ -36,6 +36,14 @@ void Application::initDevices()
     auto config = loadConfig(CONFIG_FILENAME);
     unsigned int index = 0;
 
+    // Set the sample rate and buffering of the devices.
+    Engine::DeviceSettings settings;
+    settings.sampleRate = config.sampleRate ? config.sampleRate : 44100;
+    settings.periodSize = config.periodSize;
+    settings.periodCount = config.periodCount;
+    settings.lowLatency = config.performanceProfile != "conservative";
+    getEngine().setDeviceSettings(settings);
+
     // Check for first starting.
     if (config.outputDevice == "") {
         // Privilege duplex devices if available.
@@ -91,6 +99,38 @@ void Application::initDevices()
     }
 }
 
+/*
+ * Initializes the devices again so that the device settings (eg: period size) apply.
+ */
+void Application::restartDevices()
+{
+    // The tracks can't go on playing or recording while the devices are replaced.
+    for (auto* document : documents) {
+        Track& track = document->getTrack();
+
+        if (track.isPlaying() || track.isRecording()) {
+            onStop(track);
+        }
+    }
+
+    getEngine().uninitOutput();
+    getEngine().uninitInput();
+    getEngine().uninitDuplex();
+
+    try {
+        initDevices();
+    }
+    catch (const std::runtime_error& e) {
+        std::cerr << "Device error: " << std::string(e.what()) << std::endl;
+        return;
+    }
+
+    time->setSampleRate(engine->getDefaultOutputSampleRate());
+    // The stats of the previous device setup don't apply anymore.
+    engine->resetCallbackStats();
+    lastCallbackStats = CallbackStats::Snapshot();
+}
+
 void Application::initAudioSystem()
 {
     // Create and initialize the audio engine object.
@@ -120,6 +160,9 @@ void Application::initAudioSystem()
     // Set sample rate for time computing.
     time->setSampleRate(engine->getDefaultOutputSampleRate());
 
+    // Launch the DSP load timer.
+    Fl::add_timeout(0.5, dsp_load_cb, this);
+
     //engine->printAllDevices(); // For debug purpose.
     std::cout << "=== Audio system initialized ===" << std::endl;
 }
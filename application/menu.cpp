@@ -45,6 +45,10 @@ void Application::createMenu()
     menu->add("Help", 0, 0, 0, FL_SUBMENU);
     menu->add("Help/Index", 0, 0, 0, 0);
     menu->add("Help/About", 0, 0, 0, 0);
+    menu->add("Help/Audio statistics", 0, [](Fl_Widget* w, void* userData) { 
+                                      Application* app = static_cast<Application*>(userData);
+                                      app->getEngine().dumpCallbackStats();
+                                  }, (void*) this);
     // etc...
 
     return;
@@ -186,6 +190,25 @@ void Application::onMenuEdit(EditID id)
         try {
             auto& track = getActiveDocument().getTrack();
 
+            // Samples can't be edited while the file is being decoded.
+            if (track.isLoading()) {
+                std::cout << "The file is still loading." << std::endl;
+                return;
+            }
+
+            // Destructive edits (and their undo/redo) change the samples the audio thread
+            // is reading, so they have to wait until the track is stopped.
+            if (!track.isNonDestructive() && (track.isPlaying() || track.isRecording())) {
+                std::cout << "Stop the track before editing its samples." << std::endl;
+                return;
+            }
+
+            // Edit commands modify samples in place, so they have to be held in memory
+            // (unless they're just laid over the samples).
+            if (!track.isNonDestructive()) {
+                track.materialize();
+            }
+
             switch (id) {
                 case EditID::MUTE:
                     onMute(track);
@@ -8,9 +8,9 @@ const Selection Application::getSelection(Track& track)
 {
     // Get the current selection.
     auto& waveform = track.getWaveform();
-    int start = waveform.getSelectionStartSample();
-    int end = waveform.getSelectionEndSample();
-    int totalSamples = static_cast<int>(track.getLeftSamples().size());
+    size_t start = waveform.getSelectionStartSample();
+    size_t end = waveform.getSelectionEndSample();
+    size_t totalSamples = track.getFrameCount();
 
     // Make sure selection is valid.
     if (start >= end || start > totalSamples || end > totalSamples) {
@@ -56,6 +56,7 @@ void Application::onPlay(Track& track)
             track.resetEndOfFile();
         }
 
+        track.updatePlaybackRange();
         track.play();
 
         getButton("record").deactivate();
@@ -79,7 +80,9 @@ void Application::onStop(Track& track)
         track.stop();
 
         if (stoppedRecording) {
-            waveform.setStereoSamples(track.getLeftSamples(), track.getRightSamples());
+            // Summarize the very last recorded samples.
+            waveform.pullNewSamples();
+            waveform.fitToScreen();
             getButton("play").activate();
         }
         else {
@@ -101,9 +104,10 @@ void Application::onPause(Track& track)
     }
     else if (track.isPaused() && !track.isPlaying()) {
         // Resume from where playback paused
-        int resumeSample = waveform.getCursorSamplePosition();
+        size_t resumeSample = waveform.getCursorSamplePosition();
         track.setPlaybackSampleIndex(resumeSample);
         track.unpause();
+        track.updatePlaybackRange();
         track.play();
         Fl::add_timeout(0.016, waveform.update_cursor_timer_cb, &track);
     }
@@ -113,8 +117,42 @@ void Application::onRecord(Track& track)
 {
     auto& waveform = track.getWaveform();
 
+    // Recorded samples are captured at the device rate.
+    if (track.getSampleRate() != track.getOutputSampleRate()) {
+        std::cout << "Can't record into a " << track.getSampleRate() << " Hz track (the device runs at "
+                  << track.getOutputSampleRate() << " Hz)." << std::endl;
+        return;
+    }
+
     // Check the app can record.
-    if (!track.isPlaying() && !track.isRecording()) {
+    if (!track.isPlaying() && !track.isRecording() && !track.isLoading()) {
+        // Recorded samples are merged into the ones held in memory.
+        track.materialize();
+
+        // The pending non-destructive edits are written into the samples first.
+        if (!track.getEditList().empty()) {
+            track.renderEdits();
+            // The edits can't be undone anymore.
+            getActiveDocument().getAudioHistory().clear();
+            updateMenuItem(MenuItemID::EDIT_UNDO, Action::DEACTIVATE, MenuLabels[MenuItemID::EDIT_UNDO]);
+            updateMenuItem(MenuItemID::EDIT_REDO, Action::DEACTIVATE, MenuLabels[MenuItemID::EDIT_REDO]);
+        }
+
+        // Stream the take into the recordings directory if required.
+        auto config = loadConfig(CONFIG_FILENAME);
+        std::string filename;
+
+        if (config.recordToDisk) {
+            std::error_code error;
+            std::filesystem::create_directories(config.recordingDirectory, error);
+            std::time_t now = std::time(nullptr);
+            char name[64];
+            std::strftime(name, sizeof(name), "take-%Y%m%d-%H%M%S.wav", std::localtime(&now));
+            filename = (std::filesystem::path(config.recordingDirectory) / name).string();
+        }
+
+        track.setRecordingFilename(filename);
+        track.setCaptureWakeup(config.captureWakeup);
         track.record();
         getButton("play").deactivate();
         Fl::add_timeout(0.016, waveform.update_cursor_timer_cb, &track);
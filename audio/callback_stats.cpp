@@ -0,0 +1,112 @@
+#include "callback_stats.h"
+#include <algorithm>
+#include <iomanip>
+#include <string>
+
+/*
+ * Adds a callback which took the given duration to fill a buffer of the given duration (both in ns).
+ * Called from the audio threads, so it never locks nor allocates.
+ */
+void CallbackStats::record(uint64_t duration, uint64_t budget)
+{
+    uint64_t microseconds = duration / 1000;
+    unsigned int bucket = microseconds ? 64 - __builtin_clzll(microseconds) : 0;
+    histogram[std::min(bucket, BUCKETS - 1)].fetch_add(1, std::memory_order_relaxed);
+
+    callbacks.fetch_add(1, std::memory_order_relaxed);
+    totalTime.fetch_add(duration, std::memory_order_relaxed);
+    totalBudget.fetch_add(budget, std::memory_order_relaxed);
+
+    if (budget && duration > budget) {
+        lateCallbacks.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint32_t load = budget ? static_cast<uint32_t>(std::min<uint64_t>(duration * 10000 / budget, UINT32_MAX)) : 0;
+    lastLoad.store(load, std::memory_order_relaxed);
+
+    // Several devices (ie: threads) can share the stats.
+    uint32_t peak = peakLoad.load(std::memory_order_relaxed);
+
+    while (load > peak && !peakLoad.compare_exchange_weak(peak, load, std::memory_order_relaxed)) {}
+
+    uint64_t longest = longestCallback.load(std::memory_order_relaxed);
+
+    while (duration > longest && !longestCallback.compare_exchange_weak(longest, duration, std::memory_order_relaxed)) {}
+}
+
+void CallbackStats::addOverrun(uint64_t frames)
+{
+    overruns.fetch_add(1, std::memory_order_relaxed);
+    droppedFrames.fetch_add(frames, std::memory_order_relaxed);
+}
+
+void CallbackStats::reset()
+{
+    for (auto& count : histogram) {
+        count.store(0, std::memory_order_relaxed);
+    }
+
+    callbacks.store(0, std::memory_order_relaxed);
+    lateCallbacks.store(0, std::memory_order_relaxed);
+    overruns.store(0, std::memory_order_relaxed);
+    droppedFrames.store(0, std::memory_order_relaxed);
+    totalTime.store(0, std::memory_order_relaxed);
+    totalBudget.store(0, std::memory_order_relaxed);
+    longestCallback.store(0, std::memory_order_relaxed);
+    lastLoad.store(0, std::memory_order_relaxed);
+    peakLoad.store(0, std::memory_order_relaxed);
+}
+
+CallbackStats::Snapshot CallbackStats::getSnapshot() const
+{
+    Snapshot snapshot;
+
+    for (unsigned int i = 0; i < BUCKETS; i++) {
+        snapshot.histogram[i] = histogram[i].load(std::memory_order_relaxed);
+    }
+
+    snapshot.callbacks = callbacks.load(std::memory_order_relaxed);
+    snapshot.lateCallbacks = lateCallbacks.load(std::memory_order_relaxed);
+    snapshot.overruns = overruns.load(std::memory_order_relaxed);
+    snapshot.droppedFrames = droppedFrames.load(std::memory_order_relaxed);
+    snapshot.totalTime = totalTime.load(std::memory_order_relaxed);
+    snapshot.totalBudget = totalBudget.load(std::memory_order_relaxed);
+    snapshot.longestCallback = longestCallback.load(std::memory_order_relaxed) / 1000.0;
+    snapshot.lastLoad = lastLoad.load(std::memory_order_relaxed) / 100.0;
+    snapshot.peakLoad = peakLoad.load(std::memory_order_relaxed) / 100.0;
+
+    return snapshot;
+}
+
+/*
+ * Prints the counters, the loads and the histogram of the callback durations.
+ */
+void CallbackStats::dump(std::ostream& out) const
+{
+    Snapshot snapshot = getSnapshot();
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+
+    out << "=== Audio callback statistics ===" << std::endl;
+    out << "Callbacks: " << snapshot.callbacks << ", late: " << snapshot.lateCallbacks
+        << ", capture overruns: " << snapshot.overruns << " (" << snapshot.droppedFrames << " frames dropped)" << std::endl;
+    out << std::fixed << std::setprecision(1) << "DSP load: average " << snapshot.getAverageLoad()
+        << " %, last " << snapshot.lastLoad << " %, peak " << snapshot.peakLoad << " %" << std::endl;
+    out << "Longest callback: " << snapshot.longestCallback << " us" << std::endl;
+    out << "Callback durations:" << std::endl;
+
+    for (unsigned int i = 0; i < BUCKETS; i++) {
+        if (snapshot.histogram[i] == 0) {
+            continue;
+        }
+
+        std::string range = i == 0 ? "< 1" : i == BUCKETS - 1 ? ">= " + std::to_string(1ULL << (i - 1))
+                                                             : std::to_string(1ULL << (i - 1)) + " - " + std::to_string(1ULL << i);
+        out << "  " << std::left << std::setw(16) << range + " us" << std::right << std::setw(12) << snapshot.histogram[i]
+            << std::setw(8) << std::setprecision(1) << 100.0 * snapshot.histogram[i] / std::max<uint64_t>(snapshot.callbacks, 1)
+            << " %" << std::endl;
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+}
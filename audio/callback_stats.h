@@ -0,0 +1,63 @@
+#ifndef CALLBACK_STATS_H
+#define CALLBACK_STATS_H
+
+#include <atomic>
+#include <array>
+#include <ostream>
+#include <cstdint>
+
+/*
+ * Measures how close the audio callbacks get to their deadline (ie: the duration of the
+ * buffer they fill). Written by the audio threads and read by the GUI thread without any
+ * lock, so the counters can be slightly out of step with each other when read.
+ */
+class CallbackStats {
+    public:
+        // Callback durations are counted in power of 2 buckets: < 1 µs, 1-2 µs, 2-4 µs...
+        // The last bucket holds everything above.
+        static constexpr unsigned int BUCKETS = 20;
+
+        struct Snapshot {
+            uint64_t callbacks = 0;
+            // Callbacks which took longer than their buffer duration.
+            uint64_t lateCallbacks = 0;
+            // Capture ring buffer overruns and the number of frames they dropped.
+            uint64_t overruns = 0;
+            uint64_t droppedFrames = 0;
+            // Time spent in the callbacks and the duration of the buffers they filled (in ns).
+            uint64_t totalTime = 0;
+            uint64_t totalBudget = 0;
+            // In percent of the buffer duration.
+            double lastLoad = 0.0;
+            double peakLoad = 0.0;
+            // In µs.
+            double longestCallback = 0.0;
+            std::array<uint64_t, BUCKETS> histogram = {};
+
+            double getAverageLoad() const { return totalBudget ? 100.0 * totalTime / totalBudget : 0.0; }
+        };
+
+    private:
+        std::atomic<uint64_t> histogram[BUCKETS] = {};
+        std::atomic<uint64_t> callbacks{0};
+        std::atomic<uint64_t> lateCallbacks{0};
+        std::atomic<uint64_t> overruns{0};
+        std::atomic<uint64_t> droppedFrames{0};
+        std::atomic<uint64_t> totalTime{0};
+        std::atomic<uint64_t> totalBudget{0};
+        std::atomic<uint64_t> longestCallback{0};
+        // In hundredths of a percent.
+        std::atomic<uint32_t> lastLoad{0};
+        std::atomic<uint32_t> peakLoad{0};
+
+    public:
+        void record(uint64_t duration, uint64_t budget);
+        void addOverrun(uint64_t frames);
+        void reset();
+        void dump(std::ostream& out) const;
+
+        // Getters.
+        Snapshot getSnapshot() const;
+};
+
+#endif // CALLBACK_STATS_H
@@ -0,0 +1,168 @@
+#include "capture_store.h"
+#include <algorithm>
+#include <cstring>
+
+CaptureStore::Block* CaptureStore::getBlock(size_t index) const
+{
+    Segment* segment = directory[index / SEGMENT_SIZE].load(std::memory_order_acquire);
+
+    return segment ? segment->blocks[index % SEGMENT_SIZE].load(std::memory_order_acquire) : nullptr;
+}
+
+/*
+ * Adds a block after the last one (writer only).
+ */
+void CaptureStore::allocateBlock()
+{
+    size_t index = allocatedBlocks;
+    Segment* segment = directory[index / SEGMENT_SIZE].load(std::memory_order_relaxed);
+
+    if (segment == nullptr) {
+        segment = new Segment();
+        directory[index / SEGMENT_SIZE].store(segment, std::memory_order_release);
+    }
+
+    // Note: The samples are written before being read, so the block is left uninitialized.
+    segment->blocks[index % SEGMENT_SIZE].store(new Block, std::memory_order_release);
+    allocatedBlocks++;
+}
+
+/*
+ * Allocates the blocks for the given number of frames ahead, so that the recording
+ * doesn't have to allocate until then.
+ */
+void CaptureStore::reserve(size_t count)
+{
+    size_t needed = std::min((count + SAMPLE_BLOCK_SIZE - 1) / SAMPLE_BLOCK_SIZE, SEGMENT_SIZE * DIRECTORY_SIZE);
+
+    while (allocatedBlocks < needed) {
+        allocateBlock();
+    }
+}
+
+/*
+ * Adds the given frames at the end of the take (writer only).
+ * Returns the number of frames added, which is less than the given count once the store is full.
+ */
+size_t CaptureStore::append(const float* left, const float* right, size_t count)
+{
+    size_t end = frameCount.load(std::memory_order_relaxed);
+    size_t appended = 0;
+
+    while (appended < count) {
+        size_t index = end / SAMPLE_BLOCK_SIZE;
+
+        if (index >= SEGMENT_SIZE * DIRECTORY_SIZE) {
+            break;
+        }
+
+        if (index >= allocatedBlocks) {
+            allocateBlock();
+        }
+
+        Block* block = getBlock(index);
+        size_t offset = end % SAMPLE_BLOCK_SIZE;
+        size_t n = std::min(count - appended, SAMPLE_BLOCK_SIZE - offset);
+        std::memcpy(block->left + offset, left + appended, n * sizeof(float));
+        std::memcpy(block->right + offset, right + appended, n * sizeof(float));
+        appended += n;
+        end += n;
+    }
+
+    // The new frames become visible to the reader.
+    frameCount.store(end, std::memory_order_release);
+
+    return appended;
+}
+
+/*
+ * Copies the given range of frames into the left and right buffers (either of them can be null).
+ * Returns the number of frames copied, which stops short at the released frames.
+ * Safe to call while frames are being appended (reader only).
+ */
+size_t CaptureStore::read(size_t start, size_t count, float* left, float* right) const
+{
+    size_t available = frameCount.load(std::memory_order_acquire);
+
+    if (start >= available || start < getReleasedFrames()) {
+        return 0;
+    }
+
+    count = std::min(count, available - start);
+    size_t copied = 0;
+
+    while (copied < count) {
+        size_t position = start + copied;
+        const Block* block = getBlock(position / SAMPLE_BLOCK_SIZE);
+        size_t offset = position % SAMPLE_BLOCK_SIZE;
+        size_t n = std::min(count - copied, SAMPLE_BLOCK_SIZE - offset);
+
+        if (left != nullptr) {
+            std::memcpy(left + copied, block->left + offset, n * sizeof(float));
+        }
+
+        if (right != nullptr) {
+            std::memcpy(right + copied, block->right + offset, n * sizeof(float));
+        }
+
+        copied += n;
+    }
+
+    return copied;
+}
+
+/*
+ * Frees the blocks lying entirely before the given frame (reader only).
+ * The writer never goes back to the blocks it has filled, so they can be freed meanwhile.
+ */
+void CaptureStore::release(size_t end)
+{
+    end = std::min(end, frameCount.load(std::memory_order_acquire));
+
+    for (; (releasedBlocks + 1) * SAMPLE_BLOCK_SIZE <= end; releasedBlocks++) {
+        Segment* segment = directory[releasedBlocks / SEGMENT_SIZE].load(std::memory_order_acquire);
+        delete segment->blocks[releasedBlocks % SEGMENT_SIZE].exchange(nullptr, std::memory_order_acq_rel);
+    }
+}
+
+/*
+ * Hands the blocks of the take (the released ones excepted) over to a sample store, which
+ * shares them instead of copying the samples. The capture is left empty.
+ * Once the recording is over only.
+ */
+SampleStore CaptureStore::takeSampleStore()
+{
+    SampleStore store;
+    size_t count = frameCount.load(std::memory_order_relaxed);
+
+    for (size_t i = releasedBlocks; i * SAMPLE_BLOCK_SIZE < count; i++) {
+        Block* block = directory[i / SEGMENT_SIZE].load(std::memory_order_relaxed)->blocks[i % SEGMENT_SIZE].exchange(nullptr);
+        store.appendBlock(std::shared_ptr<Block>(block), std::min<size_t>(count - i * SAMPLE_BLOCK_SIZE, SAMPLE_BLOCK_SIZE));
+    }
+
+    clear();
+
+    return store;
+}
+
+/*
+ * Drops the take. No reader nor writer must use the store in the meantime.
+ */
+void CaptureStore::clear()
+{
+    for (auto& entry : directory) {
+        Segment* segment = entry.exchange(nullptr, std::memory_order_relaxed);
+
+        if (segment != nullptr) {
+            for (auto& block : segment->blocks) {
+                delete block.load(std::memory_order_relaxed);
+            }
+
+            delete segment;
+        }
+    }
+
+    frameCount.store(0, std::memory_order_relaxed);
+    allocatedBlocks = 0;
+    releasedBlocks = 0;
+}
@@ -0,0 +1,61 @@
+#ifndef CAPTURE_STORE_H
+#define CAPTURE_STORE_H
+
+#include <atomic>
+#include <array>
+#include <memory>
+#include <cstddef>
+#include "sample_store.h"
+
+/*
+ * Append-only storage for the samples being recorded, made of fixed-size blocks
+ * which never move once allocated. Appending costs the same whatever the length of the
+ * take and never copies the samples already recorded.
+ * There's a single writer (the capture worker) and a single reader (the GUI drawing
+ * the take): The blocks are reached through a two-level table of pointers which is never
+ * reallocated, and the frame count is published once the frames are written, so the
+ * reader never locks and never sees a frame being written.
+ * The reader can also free the oldest blocks (eg: once they're saved on disk).
+ */
+class CaptureStore {
+        using Block = SampleStore::Block;
+
+        // Number of block pointers per segment and number of segments
+        // (ie: about 17 days of recording at 48 kHz).
+        static constexpr size_t SEGMENT_SIZE = 1024;
+        static constexpr size_t DIRECTORY_SIZE = 1024;
+
+        struct Segment {
+            std::atomic<Block*> blocks[SEGMENT_SIZE] = {};
+        };
+
+        std::array<std::atomic<Segment*>, DIRECTORY_SIZE> directory = {};
+        // The frames the reader can access.
+        std::atomic<size_t> frameCount{0};
+        // Writer only: The number of blocks allocated so far.
+        size_t allocatedBlocks = 0;
+        // Reader only: The blocks freed so far (ie: the first ones).
+        size_t releasedBlocks = 0;
+
+        Block* getBlock(size_t index) const;
+        void allocateBlock();
+
+    public:
+        CaptureStore() = default;
+        CaptureStore(const CaptureStore&) = delete;
+        CaptureStore& operator=(const CaptureStore&) = delete;
+        ~CaptureStore() { clear(); }
+
+        void reserve(size_t count);
+        size_t append(const float* left, const float* right, size_t count);
+        size_t read(size_t start, size_t count, float* left, float* right) const;
+        void release(size_t end);
+        SampleStore takeSampleStore();
+        void clear();
+
+        // Getters.
+        size_t size() const { return frameCount.load(std::memory_order_acquire); }
+        size_t getReleasedFrames() const { return releasedBlocks * SAMPLE_BLOCK_SIZE; }
+};
+
+#endif // CAPTURE_STORE_H
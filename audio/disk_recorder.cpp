@@ -0,0 +1,262 @@
+#include "disk_recorder.h"
+#include "../constants.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <iostream>
+
+// WAV files are little-endian.
+static void writeU16(unsigned char* p, ma_uint32 value) { p[0] = value & 0xFF; p[1] = (value >> 8) & 0xFF; }
+static void writeU32(unsigned char* p, ma_uint32 value) { writeU16(p, value & 0xFFFF); writeU16(p + 2, value >> 16); }
+static void writeU64(unsigned char* p, ma_uint64 value) { writeU32(p, static_cast<ma_uint32>(value)); writeU32(p + 4, static_cast<ma_uint32>(value >> 32)); }
+
+/*
+ * Creates the file and writes an empty take into it. Returns false if the file can't be created.
+ */
+bool DiskRecorder::open(const std::string& name, ma_uint32 rate, ma_uint32 channelCount)
+{
+    close();
+
+    fd = ::open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0) {
+        std::cerr << "Failed to create " << name << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    readFd = ::open(name.c_str(), O_RDONLY);
+
+    if (readFd < 0) {
+        std::cerr << "Failed to open " << name << ": " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    filename = name;
+    sampleRate = rate;
+    channels = channelCount;
+    buffer.assign(static_cast<size_t>(RECORDING_BUFFER_SIZE) * channels, 0.0f);
+    bufferedFrames = 0;
+    frameCount = 0;
+    headerFrameCount = 0;
+    flushedFrames.store(0, std::memory_order_relaxed);
+    failed = false;
+
+    // The samples are written after the header.
+    lseek(fd, HEADER_SIZE, SEEK_SET);
+    updateHeader();
+
+    return !failed;
+}
+
+/*
+ * Writes the whole given data at the current file position. Returns false on failure.
+ */
+bool DiskRecorder::writeAll(const void* data, size_t size)
+{
+    const char* p = static_cast<const char*>(data);
+
+    while (size > 0) {
+        ssize_t written = ::write(fd, p, size);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return false;
+        }
+
+        p += written;
+        size -= static_cast<size_t>(written);
+    }
+
+    return true;
+}
+
+/*
+ * Writes the buffered frames into the file.
+ */
+void DiskRecorder::flush()
+{
+    if (bufferedFrames == 0 || failed) {
+        bufferedFrames = 0;
+        return;
+    }
+
+    if (!writeAll(buffer.data(), bufferedFrames * channels * sizeof(float))) {
+        // Keep on recording in memory anyway.
+        std::cerr << "Failed to write into " << filename << ": " << std::strerror(errno) << std::endl;
+        failed = true;
+        return;
+    }
+
+    flushedFrames.store(frameCount, std::memory_order_release);
+    bufferedFrames = 0;
+}
+
+/*
+ * Writes the sizes of the frames written so far into the header and makes sure
+ * they're on disk, so that the file can be read whatever happens afterwards.
+ */
+void DiskRecorder::updateHeader()
+{
+    if (failed) {
+        return;
+    }
+
+    const ma_uint32 blockAlign = channels * sizeof(float);
+    const ma_uint64 frames = flushedFrames.load(std::memory_order_relaxed);
+    const ma_uint64 dataSize = frames * blockAlign;
+    const ma_uint64 riffSize = HEADER_SIZE - 8 + dataSize;
+    const bool rf64 = riffSize > 0xFFFFFFFF;
+    unsigned char header[HEADER_SIZE] = {};
+
+    std::memcpy(header, rf64 ? "RF64" : "RIFF", 4);
+    writeU32(header + 4, rf64 ? 0xFFFFFFFF : static_cast<ma_uint32>(riffSize));
+    std::memcpy(header + 8, "WAVE", 4);
+    // Room for the 64 bit sizes.
+    std::memcpy(header + 12, rf64 ? "ds64" : "JUNK", 4);
+    writeU32(header + 16, 28);
+
+    if (rf64) {
+        writeU64(header + 20, riffSize);
+        writeU64(header + 28, dataSize);
+        writeU64(header + 36, frames);
+    }
+
+    std::memcpy(header + 48, "fmt ", 4);
+    writeU32(header + 52, 16);
+    // IEEE float.
+    writeU16(header + 56, 3);
+    writeU16(header + 58, channels);
+    writeU32(header + 60, sampleRate);
+    writeU32(header + 64, sampleRate * blockAlign);
+    writeU16(header + 68, blockAlign);
+    writeU16(header + 70, 32);
+    std::memcpy(header + 72, "data", 4);
+    writeU32(header + 76, rf64 ? 0xFFFFFFFF : static_cast<ma_uint32>(dataSize));
+
+    if (::pwrite(fd, header, HEADER_SIZE, 0) != static_cast<ssize_t>(HEADER_SIZE) || fdatasync(fd) != 0) {
+        std::cerr << "Failed to update " << filename << ": " << std::strerror(errno) << std::endl;
+        failed = true;
+    }
+
+    headerFrameCount = frameCount;
+}
+
+/*
+ * Adds the given interleaved frames to the take (capture worker only).
+ */
+void DiskRecorder::write(const float* frames, size_t count)
+{
+    if (fd < 0 || failed) {
+        return;
+    }
+
+    while (count > 0) {
+        size_t n = std::min(count, static_cast<size_t>(RECORDING_BUFFER_SIZE) - bufferedFrames);
+        std::copy(frames, frames + n * channels, buffer.begin() + bufferedFrames * channels);
+        frames += n * channels;
+        bufferedFrames += n;
+        frameCount += n;
+        count -= n;
+
+        if (bufferedFrames == RECORDING_BUFFER_SIZE) {
+            flush();
+        }
+    }
+
+    if (frameCount - headerFrameCount >= static_cast<size_t>(sampleRate) * RECORDING_HEADER_INTERVAL) {
+        flush();
+        updateHeader();
+    }
+}
+
+/*
+ * Writes the last frames and the final header. The frames can still be read
+ * until the recorder is closed.
+ */
+void DiskRecorder::finish()
+{
+    if (fd < 0) {
+        return;
+    }
+
+    flush();
+    updateHeader();
+    ::close(fd);
+    fd = -1;
+
+    if (!failed) {
+        std::cout << "Take saved to " << filename << " (" << frameCount << " frames)" << std::endl;
+    }
+}
+
+void DiskRecorder::close()
+{
+    finish();
+
+    if (readFd >= 0) {
+        ::close(readFd);
+        readFd = -1;
+    }
+
+    buffer.clear();
+    buffer.shrink_to_fit();
+    readBuffer.clear();
+    readBuffer.shrink_to_fit();
+}
+
+/*
+ * Reads the given range of frames back from the file into the left and right buffers
+ * (either of them can be null). Only the frames already written into the file can be read.
+ * Mono takes are mirrored on the right channel. Returns the number of frames read.
+ */
+size_t DiskRecorder::read(size_t start, size_t count, float* left, float* right) const
+{
+    size_t available = flushedFrames.load(std::memory_order_acquire);
+
+    if (readFd < 0 || start >= available) {
+        return 0;
+    }
+
+    count = std::min(count, available - start);
+    readBuffer.resize(count * channels);
+    const size_t size = count * channels * sizeof(float);
+    const off_t offset = static_cast<off_t>(HEADER_SIZE + start * channels * sizeof(float));
+    size_t done = 0;
+
+    while (done < size) {
+        ssize_t n = ::pread(readFd, reinterpret_cast<char*>(readBuffer.data()) + done, size - done, offset + done);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (n <= 0) {
+            break;
+        }
+
+        done += static_cast<size_t>(n);
+    }
+
+    count = done / (channels * sizeof(float));
+    const size_t rightChannel = channels > 1 ? 1 : 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (left != nullptr) {
+            left[i] = readBuffer[i * channels];
+        }
+
+        if (right != nullptr) {
+            right[i] = readBuffer[i * channels + rightChannel];
+        }
+    }
+
+    return count;
+}
@@ -0,0 +1,66 @@
+#ifndef DISK_RECORDER_H
+#define DISK_RECORDER_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstddef>
+#include "../../libraries/miniaudio.h"
+
+/*
+ * Streams the recorded frames into a 32-bit float WAV file as they come in, so a take
+ * can be as long as the disk allows and survives a crash of the application.
+ * Frames are buffered and written sequentially, and the header is brought up to date
+ * at regular intervals (ie: a crash loses the last interval at most). The file switches
+ * to RF64 once it gets beyond the 4 GB limit of the WAV format.
+ * Written by the capture worker. The frames already written can be read back by
+ * another thread (eg: the GUI drawing the take).
+ */
+class DiskRecorder {
+        // RIFF header, JUNK chunk (replaced by ds64 for RF64), fmt chunk, data chunk header.
+        static constexpr size_t HEADER_SIZE = 80;
+
+        std::string filename;
+        int fd = -1;
+        // Used to read the frames back.
+        int readFd = -1;
+        ma_uint32 channels = 2;
+        ma_uint32 sampleRate = 0;
+        // Interleaved frames waiting to be written.
+        std::vector<float> buffer;
+        size_t bufferedFrames = 0;
+        // The frames written so far (buffered ones included).
+        size_t frameCount = 0;
+        size_t headerFrameCount = 0;
+        // The frames actually written into the file.
+        std::atomic<size_t> flushedFrames{0};
+        bool failed = false;
+        // Used to read the frames back.
+        mutable std::vector<float> readBuffer;
+
+        void flush();
+        void updateHeader();
+        bool writeAll(const void* data, size_t size);
+
+    public:
+        DiskRecorder() = default;
+        ~DiskRecorder() { close(); }
+        // Not copyable (owns the file).
+        DiskRecorder(const DiskRecorder&) = delete;
+        DiskRecorder& operator=(const DiskRecorder&) = delete;
+
+        bool open(const std::string& name, ma_uint32 rate, ma_uint32 channelCount);
+        void write(const float* frames, size_t count);
+        void finish();
+        void close();
+        size_t read(size_t start, size_t count, float* left, float* right) const;
+
+        // Getters.
+        bool isOpen() const { return readFd >= 0; }
+        // No write has failed so far (ie: the file holds every frame flushed).
+        bool isHealthy() const { return readFd >= 0 && !failed; }
+        const std::string& getFilename() const { return filename; }
+        size_t getFlushedFrames() const { return flushedFrames.load(std::memory_order_acquire); }
+};
+
+#endif // DISK_RECORDER_H
@@ -1,10 +1,12 @@
 #ifndef COMMAND_H
 #define COMMAND_H
 
+#include <vector>
 
 // Forward declaration.
 class Track;
 class Waveform;
+class SampleStore;
 
 /*
  * Abstract class all audio edit commands (mute, normalize, fade in...) are built from. 
@@ -16,6 +18,8 @@ class Command {
         virtual void apply(Track& track) = 0;
         virtual void undo(Track& track) = 0;
         virtual EditID editID() = 0;
+        // Returns the samples the command keeps to be undone or redone.
+        virtual std::vector<SampleStore*> getBackups() { return {}; }
 };
 
 #endif // COMMAND_H
@@ -1,55 +1,50 @@
 #ifndef DELETE_H
 #define DELETE_H
 
-#include <vector>
 #include "command.h"
+#include "../sample_store.h"
 
 /*
  * Creates a delete edit command pattern/object.
  */
 class Delete : public Command {
     public:
-        Delete(int start, int end)
+        Delete(size_t start, size_t end)
             : startSample(start), endSample(end) {}
 
         void apply(Track& track) override
         {
-            // First, save the initial state of the track samples.
-            backupLeft.assign(track.getLeftSamples().begin() + static_cast<size_t>(startSample),
-                              track.getLeftSamples().begin() + static_cast<size_t>(endSample));
-            backupRight.assign(track.getRightSamples().begin() + static_cast<size_t>(startSample),
-                               track.getRightSamples().begin() + static_cast<size_t>(endSample));
+            // Non-destructive mode: The samples are left untouched.
+            if (track.isNonDestructive()) {
+                track.getEditList().add({EditList::Type::DELETION, startSample, endSample, 1.0f, 1.0f});
+                track.getWaveform().updatePeaks(startSample, track.getFrameCount());
+                return;
+            }
+
+            // First, keep the selected samples (the blocks are shared, not copied).
+            removed = track.getSamples().slice(startSample, endSample);
 
             // Delete the selected samples.
-            track.getLeftSamples().erase(track.getLeftSamples().begin() + static_cast<size_t>(startSample),
-                                         track.getLeftSamples().begin() + static_cast<size_t>(endSample));
-            track.getRightSamples().erase(track.getRightSamples().begin() + static_cast<size_t>(startSample),
-                                          track.getRightSamples().begin() + static_cast<size_t>(endSample));
+            track.getSamples().erase(startSample, endSample);
 
-            // The sample vectors used to draw audio waveforms has to be modified as well.
-            auto& waveform = track.getWaveform();
-            
-            waveform.getLeftSamples().erase(waveform.getLeftSamples().begin() + static_cast<size_t>(startSample),
-                                            waveform.getLeftSamples().begin() + static_cast<size_t>(endSample));
-            waveform.getRightSamples().erase(waveform.getRightSamples().begin() + static_cast<size_t>(startSample),
-                                             waveform.getRightSamples().begin() + static_cast<size_t>(endSample));
+            // The samples after the deleted ones have moved.
+            track.getWaveform().updatePeaks(startSample, track.getFrameCount());
         }
 
         void undo(Track& track) override
         {
-            // Restore the track samples to their initial state.
-            track.getLeftSamples().insert(track.getLeftSamples().begin() + static_cast<size_t>(startSample),
-                                          backupLeft.begin(), backupLeft.end());
-            track.getRightSamples().insert(track.getRightSamples().begin() + static_cast<size_t>(startSample),
-                                           backupRight.begin(), backupRight.end());
+            if (track.isNonDestructive()) {
+                track.getEditList().removeLast();
+            }
+            else {
+                // Restore the track samples to their initial state.
+                track.getSamples().insert(startSample, removed);
+                removed.clear();
+            }
 
-            // The sample vectors used to draw audio waveforms has to be restored as well.
+            // Redraw the restored samples and the ones after them.
             auto& waveform = track.getWaveform();
-
-            waveform.getLeftSamples().insert(waveform.getLeftSamples().begin() + static_cast<size_t>(startSample),
-                                             backupLeft.begin(), backupLeft.end());
-            waveform.getRightSamples().insert(waveform.getRightSamples().begin() + static_cast<size_t>(startSample),
-                                              backupRight.begin(), backupRight.end());
+            waveform.updatePeaks(startSample, track.getFrameCount());
 
             // Restore the selection as well.
             waveform.setSelectionStartSample(startSample);
@@ -59,12 +54,14 @@ class Delete : public Command {
         // Returns the edit command identifier.
         EditID editID() { return EditID::DELETE; }
 
+        // Returns the samples kept to undo or redo the command.
+        std::vector<SampleStore*> getBackups() override { return {&removed}; }
+
     private:
 
-        int startSample;
-        int endSample;
-        std::vector<float> backupLeft;
-        std::vector<float> backupRight;
+        size_t startSample;
+        size_t endSample;
+        SampleStore removed;
 };
 
 #endif // DELETE_H
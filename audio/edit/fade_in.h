@@ -1,61 +1,68 @@
 #ifndef FADE_IN_H
 #define FADE_IN_H
 
-#include <vector>
 #include "command.h"
+#include "../sample_store.h"
+#include "../kernels.h"
 
 /*
  * Creates a fade in edit command pattern/object.
  */
 class FadeIn: public Command {
     public:
-        FadeIn(int start, int end)
+        FadeIn(size_t start, size_t end)
             : startSample(start), endSample(end) {}
 
         void apply(Track& track) override
         {
-            // First, save the initial state of the track samples.
-            backupLeft.assign(track.getLeftSamples().begin() + static_cast<size_t>(startSample),
-                              track.getLeftSamples().begin() + static_cast<size_t>(endSample));
-            backupRight.assign(track.getRightSamples().begin() + static_cast<size_t>(startSample),
-                               track.getRightSamples().begin() + static_cast<size_t>(endSample));
+            // Non-destructive mode: The samples are left untouched.
+            if (track.isNonDestructive()) {
+                track.getEditList().add({EditList::Type::GAIN_RAMP, startSample, endSample, 0.0f, 1.0f});
+                track.getWaveform().updatePeaks(startSample, endSample);
+                return;
+            }
 
-            // The sample vectors used to draw audio waveforms has to be modified as well.
-            auto& waveform = track.getWaveform();
+            // First, keep the initial blocks of the track samples. They're copied
+            // only as they get modified (ie: copy-on-write).
+            original = track.getSamples().slice(startSample, endSample);
 
-            int length = endSample - startSample;
+            // Redo: Just swap the modified blocks back in.
+            if (!modified.empty()) {
+                track.getSamples().replace(startSample, endSample, modified);
+                modified.clear();
+                track.getWaveform().updatePeaks(startSample, endSample);
+                return;
+            }
 
-            // Compute a linear gain ramp going from 0.0 to 1.0.
-            for (int i = 0; i < length; ++i) {
-                float gain = static_cast<float>(i) / (length - 1);
-                int idx = startSample + i;
+            size_t length = endSample - startSample;
+            size_t start = startSample;
+            float step = length > 1 ? 1.0f / static_cast<float>(length - 1) : 0.0f;
 
-                // Multiply samples by the newly computed gain ramp.
+            // Multiply samples by a linear gain ramp going from 0.0 to 1.0.
+            // The gain only depends on the sample position, so the parts can be processed in parallel.
+            track.getSamples().process(startSample, length, [=](size_t position, float* samples, size_t count) {
+                Kernels::gainRamp(samples, count, position - start, 0.0f, step);
+            });
 
-                // Audio
-                track.getLeftSamples()[idx]  *= gain;
-                track.getRightSamples()[idx] *= gain;
-                // View
-                waveform.getLeftSamples()[idx] *= gain;
-                waveform.getRightSamples()[idx] *= gain;
-            }
+            // Redraw the modified samples.
+            track.getWaveform().updatePeaks(startSample, endSample);
         }
 
         void undo(Track& track) override
         {
-            // Restore the track samples to their initial state.
-            std::copy(backupLeft.begin(), backupLeft.end(),
-                      track.getLeftSamples().begin() + static_cast<size_t>(startSample));
-            std::copy(backupRight.begin(), backupRight.end(),
-                      track.getRightSamples().begin() + static_cast<size_t>(startSample));
+            if (track.isNonDestructive()) {
+                track.getEditList().removeLast();
+            }
+            else {
+                // Keep the modified blocks for redo, then swap the initial ones back in.
+                modified = track.getSamples().slice(startSample, endSample);
+                track.getSamples().replace(startSample, endSample, original);
+                original.clear();
+            }
 
-            // The sample vectors used to draw audio waveforms has to be restored as well.
+            // Redraw the restored samples.
             auto& waveform = track.getWaveform();
-
-            std::copy(backupLeft.begin(), backupLeft.end(),
-                      waveform.getLeftSamples().begin() + static_cast<size_t>(startSample));
-            std::copy(backupRight.begin(), backupRight.end(),
-                      waveform.getRightSamples().begin() + static_cast<size_t>(startSample));
+            waveform.updatePeaks(startSample, endSample);
 
             // Restore the selection as well.
             waveform.setSelectionStartSample(startSample);
@@ -65,12 +72,15 @@ class FadeIn: public Command {
         // Returns the edit command identifier.
         EditID editID() { return EditID::FADE_IN; }
 
+        // Returns the samples kept to undo or redo the command.
+        std::vector<SampleStore*> getBackups() override { return {&original, &modified}; }
+
     private:
 
-        int startSample;
-        int endSample;
-        std::vector<float> backupLeft;
-        std::vector<float> backupRight;
+        size_t startSample;
+        size_t endSample;
+        SampleStore original;
+        SampleStore modified;
 };
 
 #endif // FADE_IN_H
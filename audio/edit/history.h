@@ -2,7 +2,16 @@
 #define HISTORY_H
 
 #include <vector>
+#include <deque>
+#include <unordered_map>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include "command.h"
+#include "../sample_store.h"
+#include "../sample_codec.h"
+#include "../spill_file.h"
 
 // Forward declaration.
 class Track;
@@ -14,60 +23,504 @@ namespace audio {
         /*
          * Class through which edit commands are performed and stored
          * as history through the undo and redo stacks.
+         * The samples kept by the old commands are compressed in the background and, when they
+         * exceed the memory budget, moved to a spill file (by the same background thread).
+         * They're loaded back as the commands get undone or redone.
          */
         class History {
             public:
 
+                History() = default;
+
+                ~History() {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        stopping = true;
+                    }
+
+                    jobReady.notify_all();
+
+                    if (compressor.joinable()) {
+                        compressor.join();
+                    }
+                }
+
                 void apply(std::unique_ptr<Command> cmd, Track& track) {
+                    std::lock_guard<std::mutex> lock(mutex);
                     cmd->apply(track);
                     lastCmdApplied = cmd->editID();
                     // Append the command to the undo stack.
-                    undoStack.push(std::move(cmd));
-                    // Initialize (or empty) the redo stack. 
-                    redoStack = {};
+                    undoStack.push_back(std::move(cmd));
+                    // Initialize (or empty) the redo stack.
+                    clearRedoStack();
+                    manageMemory();
                 }
 
                 void undo(Track& track) {
-                    if (undoStack.empty()) {
+                    std::lock_guard<std::mutex> lock(mutex);
+
+                    if (undoStack.empty() || !reload(undoStack.back().get())) {
                         return;
                     }
 
-                    auto cmd = std::move(undoStack.top());
+                    auto cmd = std::move(undoStack.back());
                     // Remove the command from the undo stack.
-                    undoStack.pop();
+                    undoStack.pop_back();
                     cmd->undo(track);
                     lastCmdApplied = cmd->editID();
                     // Append the command to the redo stack.
-                    redoStack.push(std::move(cmd));
+                    redoStack.push_back(std::move(cmd));
+                    manageMemory();
                 }
 
                 void redo(Track& track) {
-                    if (redoStack.empty()) {
+                    std::lock_guard<std::mutex> lock(mutex);
+
+                    if (redoStack.empty() || !reload(redoStack.back().get())) {
                         return;
                     }
 
-                    auto cmd = std::move(redoStack.top());
+                    auto cmd = std::move(redoStack.back());
                     // Remove the command from the redo stack.
-                    redoStack.pop();
+                    redoStack.pop_back();
                     // Apply the command again.
                     cmd->apply(track);
                     lastCmdApplied = cmd->editID();
                     // Append the command to the undo stack.
-                    undoStack.push(std::move(cmd));
+                    undoStack.push_back(std::move(cmd));
+                    manageMemory();
+                }
+
+                /*
+                 * Drops all the commands (eg: the samples they refer to have been replaced).
+                 */
+                void clear() {
+                    std::lock_guard<std::mutex> lock(mutex);
+
+                    for (const auto& entry : cold) {
+                        for (const auto& record : entry.second.records) {
+                            spillFile.release(record);
+                        }
+                    }
+
+                    cold.clear();
+                    pending.clear();
+                    jobs.clear();
+                    undoStack.clear();
+                    redoStack.clear();
+                    lastCmdApplied = EditID::NONE;
+                }
+
+                const EditID getLastUndo() {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    return !undoStack.empty() ? undoStack.back()->editID() : EditID::NONE;
+                }
+
+                const EditID getLastRedo() {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    return !redoStack.empty() ? redoStack.back()->editID() : EditID::NONE;
+                }
+
+                /*
+                 * Returns the memory (in bytes) taken by the samples the commands keep in memory,
+                 * compressed or not.
+                 */
+                size_t getMemoryUsage() {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    return computeMemoryUsage();
+                }
+
+                // Returns the size (in bytes) of the samples moved to the spill file.
+                size_t getSpilledSize() {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    return spillFile.getUsedSize();
                 }
 
-                const EditID getLastUndo() { return !undoStack.empty() ? undoStack.top()->editID() : EditID::NONE; }
-                const EditID getLastRedo() { return !redoStack.empty() ? redoStack.top()->editID() : EditID::NONE; }
+                size_t getMemoryBudget() const { return memoryBudget; }
+
+                /*
+                 * Sets the memory budget in bytes (0 = no limit).
+                 */
+                void setMemoryBudget(size_t budget) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    memoryBudget = budget;
+                    enforceBudget();
+                }
 
             private:
 
-                std::stack<std::unique_ptr<Command>> undoStack;
-                std::stack<std::unique_ptr<Command>> redoStack;
+                // The backups of a command once moved out of its sample stores.
+                struct ColdBackups {
+                    // Compressed backups kept in memory.
+                    std::vector<std::vector<uint8_t>> data;
+                    // Compressed backups moved to the spill file.
+                    std::vector<SpillFile::Record> records;
+                    bool spilled = false;
+                };
+
+                struct CompressionJob {
+                    unsigned long id;
+                    Command* cmd;
+                    // Copies of the command backups (the blocks are shared, not copied).
+                    std::vector<SampleStore> backups;
+                    // Copies of the backups already compressed (ie: they're only spilled).
+                    std::vector<std::vector<uint8_t>> data;
+                };
+
+                struct PendingJob {
+                    unsigned long id;
+                    // The memory taken by the command backups when the job was queued
+                    // (their blocks look shared as long as the job holds copies of them).
+                    size_t usage;
+                    // The compressed backups go to the spill file.
+                    bool spill;
+                };
+
+                // Used as stacks (ie: the back is the top) so that the oldest commands can be reached.
+                std::deque<std::unique_ptr<Command>> undoStack;
+                std::deque<std::unique_ptr<Command>> redoStack;
                 // To trace the last command applied.
                 EditID lastCmdApplied = EditID::NONE;
+                size_t memoryBudget = 0;
+                SpillFile spillFile;
+                // The commands whose backups are compressed or spilled.
+                std::unordered_map<const Command*, ColdBackups> cold;
+                // The commands waiting for the compressor.
+                std::unordered_map<const Command*, PendingJob> pending;
+                std::deque<CompressionJob> jobs;
+                unsigned long lastJobId = 0;
+                // Compresses the backups of the old commands in the background.
+                std::thread compressor;
+                // Guards the stacks and the commands they hold.
+                std::mutex mutex;
+                std::condition_variable jobReady;
+                bool stopping = false;
+
+                /*
+                 * Returns the old commands, oldest first. The next commands to undo and redo
+                 * are always left out as they're likely to be used soon.
+                 */
+                std::vector<Command*> getColdCommands() const {
+                    std::vector<Command*> commands;
+
+                    for (size_t i = 0; i + 1 < undoStack.size(); i++) {
+                        commands.push_back(undoStack[i].get());
+                    }
+
+                    for (size_t i = 0; i + 1 < redoStack.size(); i++) {
+                        commands.push_back(redoStack[i].get());
+                    }
+
+                    return commands;
+                }
+
+                size_t getMemoryUsage(Command* cmd) const {
+                    auto job = pending.find(cmd);
+
+                    if (job != pending.end()) {
+                        return job->second.usage;
+                    }
+
+                    auto it = cold.find(cmd);
+                    size_t usage = 0;
+
+                    if (it != cold.end()) {
+                        for (const auto& data : it->second.data) {
+                            usage += data.size();
+                        }
+
+                        return usage;
+                    }
+
+                    for (auto backup : cmd->getBackups()) {
+                        usage += backup->getMemoryUsage();
+                    }
+
+                    return usage;
+                }
+
+                size_t computeMemoryUsage() const {
+                    size_t usage = 0;
+
+                    for (const auto& cmd : undoStack) {
+                        usage += getMemoryUsage(cmd.get());
+                    }
+
+                    for (const auto& cmd : redoStack) {
+                        usage += getMemoryUsage(cmd.get());
+                    }
+
+                    return usage;
+                }
+
+                void clearRedoStack() {
+                    // Free the space taken in the spill file by the dropped commands.
+                    for (const auto& cmd : redoStack) {
+                        auto it = cold.find(cmd.get());
+
+                        if (it != cold.end()) {
+                            for (const auto& record : it->second.records) {
+                                spillFile.release(record);
+                            }
+
+                            cold.erase(it);
+                        }
+
+                        pending.erase(cmd.get());
+                    }
+
+                    redoStack.clear();
+                }
+
+                void manageMemory() {
+                    queueCompression();
+                    enforceBudget();
+                }
+
+                /*
+                 * Checks whether the backups of the given command share blocks with other stores
+                 * (eg: the track samples). Compressing them would free nothing, and they would
+                 * take more memory once loaded back as they would no longer be shared.
+                 */
+                bool isShared(Command* cmd) const {
+                    for (auto backup : cmd->getBackups()) {
+                        if (backup->isShared()) {
+                            return true;
+                        }
+                    }
+
+                    return false;
+                }
+
+                /*
+                 * Hands the backups of the given command (or the compressed ones) over to the compressor.
+                 */
+                void queueJob(Command* cmd, bool spill) {
+                    // Measured before the copies of the backups share their blocks.
+                    size_t usage = getMemoryUsage(cmd);
+                    CompressionJob job = {++lastJobId, cmd, {}, {}};
+                    auto it = cold.find(cmd);
+
+                    if (it != cold.end()) {
+                        job.data = it->second.data;
+                    }
+                    else {
+                        for (auto backup : cmd->getBackups()) {
+                            job.backups.push_back(*backup);
+                        }
+                    }
+
+                    pending[cmd] = {job.id, usage, spill};
+                    jobs.push_back(std::move(job));
+
+                    // The compressor is started on the first job.
+                    if (!compressor.joinable()) {
+                        compressor = std::thread(&History::compressorLoop, this);
+                    }
+
+                    jobReady.notify_one();
+                }
+
+                /*
+                 * Hands the backups of the old commands over to the compressor.
+                 */
+                void queueCompression() {
+                    for (auto cmd : getColdCommands()) {
+                        if (cold.count(cmd) || pending.count(cmd) || isShared(cmd)) {
+                            continue;
+                        }
+
+                        queueJob(cmd, false);
+                    }
+                }
+
+                bool isPending(const CompressionJob& job) const {
+                    auto it = pending.find(job.cmd);
+                    return it != pending.end() && it->second.id == job.id;
+                }
+
+                /*
+                 * Moves the given compressed backups to the spill file (compressor thread).
+                 * They're left in memory if they couldn't be written.
+                 */
+                void spill(ColdBackups& entry) {
+                    std::vector<SpillFile::Record> records;
+
+                    try {
+                        for (const auto& bytes : entry.data) {
+                            records.push_back(spillFile.write(bytes));
+                        }
+                    }
+                    catch (const std::runtime_error& e) {
+                        std::cerr << "History spill error: " << e.what() << std::endl;
+
+                        for (const auto& record : records) {
+                            spillFile.release(record);
+                        }
+
+                        return;
+                    }
+
+                    entry.data.clear();
+                    entry.data.shrink_to_fit();
+                    entry.records = std::move(records);
+                    entry.spilled = true;
+                }
+
+                void compressorLoop() {
+                    std::unique_lock<std::mutex> lock(mutex);
+
+                    while (true) {
+                        jobReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+
+                        if (stopping) {
+                            return;
+                        }
+
+                        auto job = std::move(jobs.front());
+                        jobs.pop_front();
+
+                        // The command has been used or dropped in the meantime.
+                        if (!isPending(job)) {
+                            continue;
+                        }
+
+                        // Compress without blocking the GUI.
+                        lock.unlock();
+                        ColdBackups entry;
+                        entry.data = std::move(job.data);
+
+                        for (const auto& backup : job.backups) {
+                            entry.data.push_back(SampleCodec::encode(backup));
+                        }
+
+                        // Release the shared blocks so they can be freed.
+                        job.backups.clear();
+                        lock.lock();
+
+                        if (!isPending(job)) {
+                            continue;
+                        }
+
+                        // The memory budget is exceeded.
+                        if (pending[job.cmd].spill) {
+                            // The spill file has its own lock.
+                            lock.unlock();
+                            // On failure, the backups stay compressed in memory until the next try.
+                            spill(entry);
+                            lock.lock();
+
+                            if (!isPending(job)) {
+                                for (const auto& record : entry.records) {
+                                    spillFile.release(record);
+                                }
+
+                                continue;
+                            }
+                        }
+
+                        pending.erase(job.cmd);
+
+                        for (auto backup : job.cmd->getBackups()) {
+                            backup->clear();
+                        }
+
+                        cold[job.cmd] = std::move(entry);
+                    }
+                }
+
+                /*
+                 * Brings the backups of the given command back into its sample stores if needed.
+                 * Returns false if they couldn't be loaded (ie: the command can't be performed).
+                 */
+                bool reload(Command* cmd) {
+                    // Any compression in progress is now out of date.
+                    pending.erase(cmd);
+                    auto it = cold.find(cmd);
+
+                    if (it == cold.end()) {
+                        return true;
+                    }
+
+                    auto backups = cmd->getBackups();
+                    std::vector<SampleStore> loaded;
+
+                    try {
+                        for (size_t i = 0; i < backups.size(); i++) {
+                            if (it->second.spilled) {
+                                loaded.push_back(SampleCodec::decode(spillFile.read(it->second.records[i])));
+                            }
+                            else {
+                                loaded.push_back(SampleCodec::decode(it->second.data[i]));
+                            }
+                        }
+                    }
+                    catch (const std::runtime_error& e) {
+                        std::cerr << "History reload error: " << e.what() << std::endl;
+                        return false;
+                    }
+
+                    for (size_t i = 0; i < backups.size(); i++) {
+                        *backups[i] = std::move(loaded[i]);
+                    }
+
+                    for (const auto& record : it->second.records) {
+                        spillFile.release(record);
+                    }
+
+                    cold.erase(it);
+
+                    return true;
+                }
+
+                /*
+                 * Has the oldest commands spilled by the compressor until the memory usage fits the budget.
+                 */
+                void enforceBudget() {
+                    if (memoryBudget == 0) {
+                        return;
+                    }
+
+                    size_t usage = computeMemoryUsage();
+
+                    // The memory of the commands on their way to the spill file is as good as freed.
+                    for (const auto& entry : pending) {
+                        if (entry.second.spill) {
+                            usage -= std::min(usage, entry.second.usage);
+                        }
+                    }
+
+                    for (auto cmd : getColdCommands()) {
+                        if (usage <= memoryBudget) {
+                            break;
+                        }
+
+                        auto job = pending.find(cmd);
+
+                        if (job != pending.end() && job->second.spill) {
+                            continue;
+                        }
+
+                        size_t cmdUsage = getMemoryUsage(cmd);
+
+                        // Already spilled, or shared with other stores.
+                        if (cmdUsage == 0 || (job == pending.end() && !cold.count(cmd) && isShared(cmd))) {
+                            continue;
+                        }
+
+                        // Being compressed: Spilled once done.
+                        if (job != pending.end()) {
+                            job->second.spill = true;
+                        }
+                        else {
+                            queueJob(cmd, true);
+                        }
+
+                        usage -= cmdUsage;
+                    }
+                }
         };
     }
 }
 
 #endif // HISTORY_H
-
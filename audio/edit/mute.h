@@ -1,54 +1,63 @@
 #ifndef MUTE_H
 #define MUTE_H
 
-#include <vector>
 #include "command.h"
+#include "../sample_store.h"
+#include "../kernels.h"
 
 /*
  * Creates a mute edit command pattern/object.
  */
 class Mute : public Command {
     public:
-        Mute(int start, int end)
+        Mute(size_t start, size_t end)
             : startSample(start), endSample(end) {}
 
         void apply(Track& track) override
         {
-            // First, save the initial state of the track samples.
-            backupLeft.assign(track.getLeftSamples().begin() + static_cast<size_t>(startSample),
-                              track.getLeftSamples().begin() + static_cast<size_t>(endSample));
-            backupRight.assign(track.getRightSamples().begin() + static_cast<size_t>(startSample),
-                               track.getRightSamples().begin() + static_cast<size_t>(endSample));
+            // Non-destructive mode: The samples are left untouched.
+            if (track.isNonDestructive()) {
+                track.getEditList().add({EditList::Type::MUTE, startSample, endSample, 0.0f, 0.0f});
+                track.getWaveform().updatePeaks(startSample, endSample);
+                return;
+            }
 
-            // The sample vectors used to draw audio waveforms has to be modified as well.
-            auto& waveform = track.getWaveform();
+            // First, keep the initial blocks of the track samples. They're copied
+            // only as they get modified (ie: copy-on-write).
+            original = track.getSamples().slice(startSample, endSample);
 
-            // Mute samples.
-            for (int i = startSample; i < endSample; i++) {
-                // Audio
-                track.getLeftSamples()[i] = 0.0f;
-                track.getRightSamples()[i] = 0.0f;
-                // View
-                waveform.getLeftSamples()[i] = 0.0f;
-                waveform.getRightSamples()[i] = 0.0f;
+            // Redo: Just swap the modified blocks back in.
+            if (!modified.empty()) {
+                track.getSamples().replace(startSample, endSample, modified);
+                modified.clear();
+                track.getWaveform().updatePeaks(startSample, endSample);
+                return;
             }
+
+            // Mute samples.
+            track.getSamples().process(startSample, endSample - startSample, [](size_t, float* samples, size_t count) {
+                Kernels::zeroFill(samples, count);
+            });
+
+            // Redraw the modified samples.
+            track.getWaveform().updatePeaks(startSample, endSample);
         }
 
         void undo(Track& track) override
         {
-            // Restore the track samples to their initial state.
-            std::copy(backupLeft.begin(), backupLeft.end(),
-                      track.getLeftSamples().begin() + static_cast<size_t>(startSample));
-            std::copy(backupRight.begin(), backupRight.end(),
-                      track.getRightSamples().begin() + static_cast<size_t>(startSample));
+            if (track.isNonDestructive()) {
+                track.getEditList().removeLast();
+            }
+            else {
+                // Keep the modified blocks for redo, then swap the initial ones back in.
+                modified = track.getSamples().slice(startSample, endSample);
+                track.getSamples().replace(startSample, endSample, original);
+                original.clear();
+            }
 
-            // The sample vectors used to draw audio waveforms has to be restored as well.
+            // Redraw the restored samples.
             auto& waveform = track.getWaveform();
-
-            std::copy(backupLeft.begin(), backupLeft.end(),
-                      waveform.getLeftSamples().begin() + static_cast<size_t>(startSample));
-            std::copy(backupRight.begin(), backupRight.end(),
-                      waveform.getRightSamples().begin() + static_cast<size_t>(startSample));
+            waveform.updatePeaks(startSample, endSample);
 
             // Restore the selection as well.
             waveform.setSelectionStartSample(startSample);
@@ -58,12 +67,15 @@ class Mute : public Command {
         // Returns the edit command identifier.
         EditID editID() { return EditID::MUTE; }
 
+        // Returns the samples kept to undo or redo the command.
+        std::vector<SampleStore*> getBackups() override { return {&original, &modified}; }
+
     private:
 
-        int startSample;
-        int endSample;
-        std::vector<float> backupLeft;
-        std::vector<float> backupRight;
+        size_t startSample;
+        size_t endSample;
+        SampleStore original;
+        SampleStore modified;
 };
 
 #endif // MUTE_H
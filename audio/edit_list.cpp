@@ -0,0 +1,197 @@
+#include "edit_list.h"
+#include "kernels.h"
+#include <algorithm>
+
+/*
+ * Makes sure a segment starts at the given position and returns its index.
+ */
+size_t EditList::splitAt(Map& map, size_t position)
+{
+    auto it = std::upper_bound(map.segments.begin(), map.segments.end(), position,
+                               [](size_t value, const Segment& segment) { return value < segment.start; });
+    size_t index = static_cast<size_t>(it - map.segments.begin()) - 1;
+
+    if (map.segments[index].start == position) {
+        return index;
+    }
+
+    // The second part goes on from where the first one stops, in the samples and in the ramps.
+    Segment second = map.segments[index];
+    size_t offset = position - second.start;
+    second.start = position;
+    second.sourceStart += offset;
+
+    for (auto& gain : second.gains) {
+        gain.offset += offset;
+    }
+
+    map.segments.insert(map.segments.begin() + index + 1, std::move(second));
+
+    return index + 1;
+}
+
+/*
+ * Lays the given edit over the segments (ie: O(segments)).
+ */
+void EditList::apply(Map& map, const Edit& edit)
+{
+    if (edit.start >= edit.end) {
+        return;
+    }
+
+    size_t first = splitAt(map, edit.start);
+    size_t last = splitAt(map, edit.end);
+    size_t length = edit.end - edit.start;
+
+    if (edit.type == Type::DELETION) {
+        map.segments.erase(map.segments.begin() + first, map.segments.begin() + last);
+
+        // The frames after the deletion are shifted by the deleted length.
+        for (size_t i = first; i < map.segments.size(); i++) {
+            map.segments[i].start -= length;
+        }
+
+        map.deletedFrames += length;
+        return;
+    }
+
+    // Same ramp as the destructive fades, so both modes give the very same samples.
+    float step = length > 1 ? (edit.endGain - edit.startGain) / (length - 1) : 0.0f;
+
+    for (size_t i = first; i < last; i++) {
+        map.segments[i].gains.push_back({edit.type, edit.startGain, step, map.segments[i].start - edit.start});
+    }
+}
+
+/*
+ * Replaces the published map, then deletes the previous one once the readers
+ * which may still be using it are done.
+ */
+void EditList::publish(std::unique_ptr<Map> next)
+{
+    const Map* previous = map.exchange(next.release(), std::memory_order_acq_rel);
+
+    if (previous != nullptr && readerBarrier) {
+        readerBarrier();
+    }
+
+    delete previous;
+}
+
+void EditList::add(const Edit& edit)
+{
+    const Map* current = map.load(std::memory_order_acquire);
+    // The segments of the current map plus the new edit.
+    auto next = current ? std::make_unique<Map>(*current) : std::make_unique<Map>(Map{{{0, 0, {}}}, 0});
+    apply(*next, edit);
+    edits.push_back(edit);
+    publish(std::move(next));
+}
+
+/*
+ * Removes the last edit added (ie: undo). The map is rebuilt from the remaining edits.
+ */
+void EditList::removeLast()
+{
+    if (edits.empty()) {
+        return;
+    }
+
+    edits.pop_back();
+
+    if (edits.empty()) {
+        publish(nullptr);
+        return;
+    }
+
+    auto next = std::make_unique<Map>(Map{{{0, 0, {}}}, 0});
+
+    for (const auto& edit : edits) {
+        apply(*next, edit);
+    }
+
+    publish(std::move(next));
+}
+
+void EditList::clear()
+{
+    edits.clear();
+    publish(nullptr);
+}
+
+size_t EditList::getFrameCount(size_t sourceFrameCount) const
+{
+    const Map* current = map.load(std::memory_order_acquire);
+    size_t deletedFrames = current ? current->deletedFrames : 0;
+
+    return sourceFrameCount > deletedFrames ? sourceFrameCount - deletedFrames : 0;
+}
+
+/*
+ * Multiplies the samples of a segment (starting at the given offset in the segment) by the gain.
+ */
+void EditList::applyGain(const Gain& gain, size_t offset, size_t count, float* samples)
+{
+    if (samples == nullptr) {
+        return;
+    }
+
+    if (gain.type == Type::MUTE) {
+        Kernels::zeroFill(samples, count);
+        return;
+    }
+
+    Kernels::gainRamp(samples, count, gain.offset + offset, gain.startGain, gain.step);
+}
+
+/*
+ * Copies the given range of frames, with all the edits applied, into the left and right
+ * buffers (either of them can be null). Returns the number of frames copied.
+ */
+size_t EditList::read(size_t start, size_t count, float* left, float* right, const SourceReader& source) const
+{
+    // The map stays alive while reading, whatever happens to the list in the meantime.
+    const Map* current = map.load(std::memory_order_acquire);
+
+    // No edits: Read the samples themselves.
+    if (current == nullptr) {
+        return source(start, count, left, right);
+    }
+
+    const auto& segments = current->segments;
+    auto it = std::upper_bound(segments.begin(), segments.end(), start,
+                               [](size_t value, const Segment& segment) { return value < segment.start; });
+    size_t index = static_cast<size_t>(it - segments.begin()) - 1;
+    size_t done = 0;
+
+    while (done < count) {
+        const Segment& segment = segments[index];
+        size_t position = start + done;
+        size_t offset = position - segment.start;
+        size_t n = count - done;
+
+        if (index + 1 < segments.size()) {
+            n = std::min(n, segments[index + 1].start - position);
+        }
+
+        float* l = left ? left + done : nullptr;
+        float* r = right ? right + done : nullptr;
+        size_t copied = source(segment.sourceStart + offset, n, l, r);
+
+        for (const auto& gain : segment.gains) {
+            applyGain(gain, offset, copied, l);
+            applyGain(gain, offset, copied, r);
+        }
+
+        done += copied;
+
+        // The end of the samples.
+        if (copied < n) {
+            break;
+        }
+
+        index++;
+    }
+
+    return done;
+}
@@ -0,0 +1,93 @@
+#ifndef EDIT_LIST_H
+#define EDIT_LIST_H
+
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+
+/*
+ * Non-destructive edits (mutes, gain ramps, deletions) laid over the samples of a track
+ * and evaluated as the samples are read (ie: playback, drawing, saving).
+ * The edits are flattened into a map of segments: Each segment is a range of frames read
+ * from a single place of the samples, along with the gains to apply to it. Reading is a
+ * binary search followed by a walk over the segments of the range, whatever the number of edits.
+ * The map is rebuilt whenever an edit is added or removed, then published atomically so that
+ * the audio thread can read it at any time. The previous map is deleted once the readers
+ * which may still use it are done (see setReaderBarrier), so reading never locks,
+ * nor frees anything.
+ */
+class EditList {
+    public:
+        enum class Type { MUTE, GAIN_RAMP, DELETION };
+
+        struct Edit {
+            Type type;
+            // Range of frames as seen when the edit was added (ie: after the previous edits).
+            size_t start;
+            size_t end;
+            // Gains of the first and last frames (GAIN_RAMP only).
+            float startGain;
+            float endGain;
+        };
+
+        // Reads the frames the edits are laid over.
+        using SourceReader = std::function<size_t(size_t start, size_t count, float* left, float* right)>;
+        // Waits until the reads started before the call are done.
+        using ReaderBarrier = std::function<void()>;
+
+    private:
+        // A mute or a gain ramp applied to a segment.
+        struct Gain {
+            Type type;
+            float startGain;
+            float step;
+            // Position of the first frame of the segment in the ramp.
+            size_t offset;
+        };
+
+        struct Segment {
+            // The first frame of the segment once the edits are applied (the segment goes
+            // on until the next one, or indefinitely for the last one).
+            size_t start;
+            // Where the frames are read from in the samples.
+            size_t sourceStart;
+            // Applied in the order the edits have been added.
+            std::vector<Gain> gains;
+        };
+
+        struct Map {
+            // Ordered by start position. The first one starts at zero.
+            std::vector<Segment> segments;
+            size_t deletedFrames;
+        };
+
+        std::atomic<const Map*> map{nullptr};
+        // The edits of the list, oldest first (GUI thread only).
+        std::vector<Edit> edits;
+        ReaderBarrier readerBarrier;
+
+        static size_t splitAt(Map& map, size_t position);
+        static void apply(Map& map, const Edit& edit);
+        static void applyGain(const Gain& gain, size_t offset, size_t count, float* samples);
+        void publish(std::unique_ptr<Map> next);
+
+    public:
+        EditList() = default;
+        EditList(const EditList&) = delete;
+        EditList& operator=(const EditList&) = delete;
+        ~EditList() { delete map.load(); }
+
+        void setReaderBarrier(ReaderBarrier barrier) { readerBarrier = std::move(barrier); }
+        void add(const Edit& edit);
+        void removeLast();
+        void clear();
+        size_t read(size_t start, size_t count, float* left, float* right, const SourceReader& source) const;
+
+        // Getters.
+        bool empty() const { return map.load(std::memory_order_acquire) == nullptr; }
+        size_t getFrameCount(size_t sourceFrameCount) const;
+};
+
+#endif // EDIT_LIST_H
@@ -1,6 +1,10 @@
 #include "engine.h"
 #include "track.h"
+#include "../main.h"
 #include <iostream>
+#include <thread>
+#include <chrono>
+#include <cstdio>
 
 /*
  * Destructor: Uninitializes all of the audio parameters before closing the app.
@@ -9,6 +13,10 @@ Engine::~Engine() {
     // Clears all audio ressources currently used by the application. 
     uninitOutput();
     uninitContext();
+    // Make sure no callback still reads the track list.
+    auto list = activeTracks.exchange(nullptr);
+    waitForCallbacks();
+    delete list;
     tracks.clear();
 }
 
@@ -46,6 +54,51 @@ std::string Engine::backendToString(ma_backend backend)
     }
 }
 
+/*
+ * Sets the sample rate, period and performance profile of the given device configuration.
+ */
+void Engine::applyDeviceSettings(ma_device_config& config)
+{
+    config.sampleRate = deviceSettings.sampleRate;
+    config.periodSizeInFrames = deviceSettings.periodSize;
+    config.periods = deviceSettings.periodCount;
+    config.performanceProfile = deviceSettings.lowLatency ? ma_performance_profile_low_latency : ma_performance_profile_conservative;
+}
+
+/*
+ * Prints the buffering the backend actually granted (it may differ from the settings).
+ */
+void Engine::reportLatency(const char* type, ma_uint32 periodSize, ma_uint32 periods, ma_uint32 sampleRate)
+{
+    double latency = sampleRate ? 1000.0 * periodSize * periods / sampleRate : 0.0;
+    char report[128];
+    snprintf(report, sizeof(report), "%.1f ms (%u frames x %u periods at %u Hz)", latency, periodSize, periods, sampleRate);
+    std::cout << type << " latency: " << report << std::endl;
+
+    // The output latency is the one heard while editing.
+    if (strcmp(type, "Capture") != 0) {
+        outputLatency = latency;
+        latencyReport = report;
+    }
+}
+
+/*
+ * Stores the device settings. The devices have to be initialized again for them to apply
+ * and the tracks are told about the new sample rate.
+ * Must be called while the devices are uninitialized.
+ */
+void Engine::setDeviceSettings(const DeviceSettings& settings)
+{
+    bool rateChanged = settings.sampleRate != deviceSettings.sampleRate;
+    deviceSettings = settings;
+
+    if (rateChanged) {
+        for (auto& track : tracks) {
+            track->updateOutputRate();
+        }
+    }
+}
+
 /*
  * Initializes the output device.
  */
@@ -55,7 +108,7 @@ void Engine::initializeOutputDevice() {
     config.playback.format = defaultOutputFormat;
     // Always playback stereo.
     config.playback.channels = 2;
-    config.sampleRate = defaultOutputSampleRate;
+    applyDeviceSettings(config);
     config.dataCallback = data_callback;
     config.pUserData = this;
 
@@ -65,6 +118,8 @@ void Engine::initializeOutputDevice() {
 
     std::cout << "Output device initialized." << std::endl;
     outputDeviceInitialized = true;
+    reportLatency("Playback", outputDevice.playback.internalPeriodSizeInFrames, outputDevice.playback.internalPeriods,
+                  outputDevice.playback.internalSampleRate);
 }
 
 void Engine::initializeInputDevice()
@@ -74,7 +129,7 @@ void Engine::initializeInputDevice()
     config.capture.format = ma_format_f32;
     // Always record stereo.
     config.capture.channels = 2;
-    config.sampleRate = defaultOutputSampleRate;
+    applyDeviceSettings(config);
     config.dataCallback = data_callback;
     config.pUserData = this;
 
@@ -84,12 +139,14 @@ void Engine::initializeInputDevice()
 
     std::cout << "Input device initialized." << std::endl;
     inputDeviceInitialized = true;
+    reportLatency("Capture", inputDevice.capture.internalPeriodSizeInFrames, inputDevice.capture.internalPeriods,
+                  inputDevice.capture.internalSampleRate);
 }
 
 void Engine::initializeDuplexDevice()
 {
     ma_device_config config = ma_device_config_init(ma_device_type_duplex);
-    config.sampleRate       = 44100;
+    applyDeviceSettings(config);
     config.playback.format  = ma_format_f32;
     config.playback.channels= 2;
     config.playback.pDeviceID = &duplexDeviceID;
@@ -104,6 +161,8 @@ void Engine::initializeDuplexDevice()
     }
 
     duplexDeviceInitialized = true;
+    reportLatency("Duplex", duplexDevice.playback.internalPeriodSizeInFrames, duplexDevice.playback.internalPeriods,
+                  duplexDevice.playback.internalSampleRate);
 }
 
 bool Engine::isDeviceDuplex(const char *name)
@@ -368,6 +427,7 @@ unsigned int Engine::addTrack(std::unique_ptr<Track> track)
     unsigned int id = track->getId();
     // Transfer ownership.
     tracks.push_back(std::move(track));
+    publishTracks();
 
     return id;
 }
@@ -395,8 +455,11 @@ void Engine::removeTrack(unsigned int id)
     [id](const std::unique_ptr<Track>& t) { return t->getId() == id; });
 
     if (it != tracks.end()) {
-        // unique_ptr destructor deletes the owned Track.
+        auto removed = std::move(*it);
         tracks.erase(it); 
+        // The audio callback no longer sees the track once this returns.
+        publishTracks();
+        // unique_ptr destructor deletes the owned Track.
     }
     // No such track. Throw an exception in case some functions need the info.
     else {
@@ -404,14 +467,127 @@ void Engine::removeTrack(unsigned int id)
     }
 }
 
+/*
+ * Replaces the track list read by the audio callback with a copy of the current one.
+ * The previous copy is deleted once no callback reads it anymore (ie: read-copy-update),
+ * so the audio thread never has to lock or allocate anything.
+ * Called from the GUI thread only.
+ */
+void Engine::publishTracks()
+{
+    auto list = new TrackList;
+
+    for (auto& track : tracks) {
+        list->tracks.push_back(track.get());
+    }
+
+    auto previous = activeTracks.exchange(list);
+    waitForCallbacks();
+    delete previous;
+}
+
+/*
+ * Waits until the callbacks running at the time of the call (if any) are done.
+ * The following callbacks can only load the track list (or any other data read by
+ * the callbacks, eg: the edit lists) published before the call.
+ */
+void Engine::waitForCallbacks()
+{
+    for (auto& epoch : callbackEpochs) {
+        uint64_t current = epoch.load();
+
+        // The callback is reading a track list (maybe the previous one).
+        while ((current & 1) && epoch.load() == current) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+}
+
+std::atomic<uint64_t>& Engine::getCallbackEpoch(ma_device* device)
+{
+    if (device == &inputDevice) {
+        return callbackEpochs[1];
+    }
+
+    if (device == &duplexDevice) {
+        return callbackEpochs[2];
+    }
+
+    return callbackEpochs[0];
+}
+
+/*
+ * Sends an event to the GUI thread. Called from the audio thread, so the GUI thread is
+ * only woken up when no wake up is pending already. Returns false if the queue is full.
+ */
+bool Engine::pushTrackEvent(TrackEvent event)
+{
+    if (!trackEvents.push(event)) {
+        return false;
+    }
+
+    if (!trackEventsNotified.exchange(true)) {
+        Fl::awake(track_events_cb, this);
+    }
+
+    return true;
+}
+
+/*
+ * Handles the events sent by the audio callback (GUI thread).
+ */
+void Engine::track_events_cb(void* data)
+{
+    Engine* engine = static_cast<Engine*>(data);
+    // Events pushed from now on will wake the GUI thread up again.
+    engine->trackEventsNotified.store(false);
+    TrackEvent event;
+
+    while (engine->trackEvents.pop(event)) {
+        Track* track = nullptr;
+
+        for (auto& t : engine->tracks) {
+            if (t->getId() == event.trackId) {
+                track = t.get();
+            }
+        }
+
+        // The track has been removed in the meantime.
+        if (track == nullptr) {
+            continue;
+        }
+
+        switch (event.type) {
+            case TrackEvent::Type::END_OF_FILE:
+            case TrackEvent::Type::END_OF_SELECTION:
+                engine->getApplication().onStop(*track);
+                break;
+
+            case TrackEvent::Type::LOOP:
+                track->getWaveform().redraw();
+                break;
+        }
+    }
+}
+
 /*
  * Callback function used by MiniAudio to feed audio data to devices.
  */
 void Engine::data_callback(ma_device* pDevice, void* output, const void* input, ma_uint32 frameCount) {
+    auto start = std::chrono::steady_clock::now();
     Engine* engine = static_cast<Engine*>(pDevice->pUserData);
+    auto& epoch = engine->getCallbackEpoch(pDevice);
+    // The time available to fill the buffer (in ns).
+    uint64_t budget = pDevice->sampleRate ? static_cast<uint64_t>(frameCount) * 1000000000ULL / pDevice->sampleRate : 0;
+
+    // Let the GUI thread know the track list is being read.
+    epoch.fetch_add(1);
+    const TrackList* list = engine->activeTracks.load();
 
     // First check there are tracks.
-    if (engine->tracks.size() == 0) {
+    if (list == nullptr || list->tracks.size() == 0) {
+        epoch.fetch_add(1, std::memory_order_release);
+        engine->callbackStats.record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(), budget);
         return;
     }
 
@@ -421,10 +597,17 @@ void Engine::data_callback(ma_device* pDevice, void* output, const void* input,
         // Clear buffer (stereo) with silence (ie: 0.0f). 
         std::fill(out, out + frameCount * 2, 0.0f);  
 
+        // Only the soloed tracks are heard (if any).
+        bool soloActive = false;
+
+        for (auto track : list->tracks) {
+            soloActive = soloActive || track->isSoloed();
+        }
+
         // Dispatch data among playing tracks.
-        for (auto& track : engine->tracks) {
+        for (auto track : list->tracks) {
             if (track->isPlaying()) {
-                track->mixInto(out, frameCount);
+                track->mixInto(out, frameCount, soloActive);
             }
         }
 
@@ -442,12 +625,20 @@ void Engine::data_callback(ma_device* pDevice, void* output, const void* input,
             captureChannels = 2;
         }
 
-        for (auto& track : engine->tracks) {
+        for (auto track : list->tracks) {
             if (track->isRecording()) {
-                track->recordInto(in, frameCount, captureChannels);
+                ma_uint32 dropped = track->recordInto(in, frameCount, captureChannels);
+
+                if (dropped > 0) {
+                    engine->callbackStats.addOverrun(dropped);
+                }
             }
         }
     }
+
+    // The track list can be deleted from now on.
+    epoch.fetch_add(1, std::memory_order_release);
+    engine->callbackStats.record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(), budget);
 }
 
 void Engine::setCurrentLevel(const float* out, const ma_uint32 frameCount)
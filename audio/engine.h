@@ -6,12 +6,32 @@
 #include <memory>
 #include <atomic>
 #include "../../libraries/miniaudio.h"
+#include "event_queue.h"
+#include "callback_stats.h"
 
 // Forward declarations.
 class Track;
 class Application;
 
 class Engine {
+    public:
+        // Event sent by the audio callback to the GUI thread.
+        struct TrackEvent {
+            enum class Type { END_OF_FILE, END_OF_SELECTION, LOOP } type;
+            unsigned int trackId;
+        };
+
+        // Device parameters applied the next time the devices are initialized.
+        struct DeviceSettings {
+            ma_uint32 sampleRate = 44100;
+            // In frames (0 = backend default).
+            ma_uint32 periodSize = 0;
+            // 0 = backend default.
+            ma_uint32 periodCount = 0;
+            bool lowLatency = true;
+        };
+
+    private:
         // Structure that holds the backend data.
         struct BackendInfo {
             std::string name;
@@ -41,10 +61,26 @@ class Engine {
         bool duplexDeviceInitialized = false;
         // Multiple loaded tracks
         std::vector<std::unique_ptr<Track>> tracks;  
+        // Immutable copy of the track list read by the audio callback.
+        struct TrackList {
+            std::vector<Track*> tracks;
+        };
+        std::atomic<const TrackList*> activeTracks{nullptr};
+        // Odd while the callback of the output, input or duplex device is reading the track list.
+        std::atomic<uint64_t> callbackEpochs[3] = {};
+        // Playback events waiting for the GUI thread.
+        EventQueue<TrackEvent, 256> trackEvents;
+        // Set while the GUI thread has been woken up and hasn't read the events yet.
+        std::atomic<bool> trackEventsNotified{false};
+        // Load, duration and overruns of the audio callbacks (all devices).
+        CallbackStats callbackStats;
         // The unique id assigned to each track.
         unsigned int trackId = 1;
         const ma_format defaultOutputFormat = ma_format_f32;
-        const ma_uint32 defaultOutputSampleRate = 44100;
+        DeviceSettings deviceSettings;
+        // The latency (in ms) and the period setup the output device actually got.
+        double outputLatency = 0.0;
+        std::string latencyReport;
         std::vector<std::string> supportedFormats = {".wav", ".WAV",".mp3", ".MP3", ".flac", ".FLAC", ".ogg", ".OGG"};
         // Used with vu-meters.
         std::atomic<float> currentLevelL {0.0f};
@@ -54,12 +90,17 @@ class Engine {
 
         std::vector<DeviceInfo> getDevices(ma_device_type deviceType);
         static void data_callback(ma_device* device, void* output, const void* input, ma_uint32 frameCount);
+        static void track_events_cb(void* data);
         void initializeOutputDevice();
         void initializeInputDevice();
         void initializeDuplexDevice();
         bool isBackendAvailable(ma_backend backend);
         std::string backendToString(ma_backend backend);
         void setCurrentLevel(const float* out, const ma_uint32 frameCount);
+        void applyDeviceSettings(ma_device_config& config);
+        void reportLatency(const char* type, ma_uint32 periodSize, ma_uint32 periods, ma_uint32 sampleRate);
+        void publishTracks();
+        std::atomic<uint64_t>& getCallbackEpoch(ma_device* device);
 
     public:
         Engine(Application* app) : pApplication(app) {} 
@@ -74,6 +115,7 @@ class Engine {
         void uninitDuplex();
         unsigned int addTrack(std::unique_ptr<Track> track);
         void removeTrack(unsigned int id);
+        bool pushTrackEvent(TrackEvent event);
         void startPlayback();
         void stopPlayback();
         void startCapture();
@@ -82,6 +124,9 @@ class Engine {
         void stopDuplex();
         size_t numberOfTracks() { return tracks.size(); }
         bool isDeviceDuplex(const char *name);
+        void dumpCallbackStats(std::ostream& out = std::cout) const { callbackStats.dump(out); }
+        void resetCallbackStats() { callbackStats.reset(); }
+        void waitForCallbacks();
 
         // Getters.
         std::vector<BackendInfo> getBackends();
@@ -91,7 +136,11 @@ class Engine {
         std::vector<std::string> getSupportedFormats() { return supportedFormats; }
         bool isContextInitialized() { return contextInitialized; }
         ma_format getDefaultOutputFormat() { return defaultOutputFormat; }
-        ma_uint32 getDefaultOutputSampleRate() { return defaultOutputSampleRate; }
+        ma_uint32 getDefaultOutputSampleRate() { return deviceSettings.sampleRate; }
+        const DeviceSettings& getDeviceSettings() const { return deviceSettings; }
+        double getOutputLatency() const { return outputLatency; }
+        const std::string& getLatencyReport() const { return latencyReport; }
+        CallbackStats::Snapshot getCallbackStats() const { return callbackStats.getSnapshot(); }
         float getCurrentLevelL() const { return currentLevelL.load(); }
         float getCurrentLevelR() const { return currentLevelR.load(); }
         float getCurrentPeakL() const { return currentPeakL.load(); }
@@ -104,6 +153,7 @@ class Engine {
         void setOutputDevice(const char *name = nullptr);
         void setInputDevice(const char *name = nullptr);
         void setDuplexDevice(const char *name = nullptr);
+        void setDeviceSettings(const DeviceSettings& settings);
 };
 
 #endif // ENGINE_H
@@ -0,0 +1,60 @@
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <atomic>
+#include <array>
+#include <cstddef>
+
+/*
+ * Fixed-size lock-free queue with a single producer thread (eg: the audio callback)
+ * and a single consumer thread (eg: the GUI). Neither side ever locks or allocates.
+ */
+template <typename T, size_t Capacity>
+class EventQueue {
+        static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+
+        std::array<T, Capacity> events;
+        // Only written by the producer.
+        std::atomic<size_t> tail{0};
+        // Only written by the consumer.
+        std::atomic<size_t> head{0};
+
+    public:
+        /*
+         * Adds an event to the queue. Returns false if the queue is full.
+         * Producer thread only.
+         */
+        bool push(const T& event)
+        {
+            size_t t = tail.load(std::memory_order_relaxed);
+
+            if (t - head.load(std::memory_order_acquire) == Capacity) {
+                return false;
+            }
+
+            events[t & (Capacity - 1)] = event;
+            tail.store(t + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        /*
+         * Takes the oldest event out of the queue. Returns false if the queue is empty.
+         * Consumer thread only.
+         */
+        bool pop(T& event)
+        {
+            size_t h = head.load(std::memory_order_relaxed);
+
+            if (h == tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+
+            event = events[h & (Capacity - 1)];
+            head.store(h + 1, std::memory_order_release);
+
+            return true;
+        }
+};
+
+#endif // EVENT_QUEUE_H
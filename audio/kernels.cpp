@@ -0,0 +1,542 @@
+#include "kernels.h"
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KERNELS_X86
+#endif
+
+/*
+ * NB: Within a variant, the ramp and mix kernels (stereo mix included) compute every sample the same way, the last
+ *     ones included, so processing a range in several parts gives the very same result.
+ *     Variants may differ in the last bit as the compiler is free to use FMA instructions.
+ */
+
+namespace {
+    // --- Scalar ---
+
+    bool scalarIsSupported() { return true; }
+
+    void scalarGainRamp(float* samples, size_t count, size_t index, float base, float step)
+    {
+        for (size_t i = 0; i < count; i++) {
+            float position = static_cast<float>(static_cast<int32_t>(index + i));
+            samples[i] *= base + position * step;
+        }
+    }
+
+    void scalarGain(float* samples, size_t count, float gain)
+    {
+        for (size_t i = 0; i < count; i++) {
+            samples[i] *= gain;
+        }
+    }
+
+    void scalarZeroFill(float* samples, size_t count)
+    {
+        std::memset(samples, 0, count * sizeof(float));
+    }
+
+    void scalarCopy(float* destination, const float* source, size_t count)
+    {
+        std::memmove(destination, source, count * sizeof(float));
+    }
+
+    void scalarMix(float* destination, const float* source, size_t count, float gain)
+    {
+        for (size_t i = 0; i < count; i++) {
+            destination[i] += source[i] * gain;
+        }
+    }
+
+    void scalarMixStereo(float* output, const float* left, const float* right, size_t count, float leftGain, float rightGain)
+    {
+        for (size_t i = 0; i < count; i++) {
+            output[i * 2] += left[i] * leftGain;
+            output[i * 2 + 1] += right[i] * rightGain;
+        }
+    }
+
+#ifdef KERNELS_X86
+    // --- SSE2 ---
+
+    bool sse2IsSupported() { return __builtin_cpu_supports("sse2"); }
+
+    __attribute__((target("sse2")))
+    inline void sse2RampStep(float* samples, size_t index, __m128 bases, __m128 steps)
+    {
+        const __m128i offsets = _mm_setr_epi32(0, 1, 2, 3);
+        __m128i indexes = _mm_add_epi32(_mm_set1_epi32(static_cast<int32_t>(index)), offsets);
+        __m128 gains = _mm_add_ps(bases, _mm_mul_ps(_mm_cvtepi32_ps(indexes), steps));
+        _mm_storeu_ps(samples, _mm_mul_ps(_mm_loadu_ps(samples), gains));
+    }
+
+    __attribute__((target("sse2")))
+    void sse2GainRamp(float* samples, size_t count, size_t index, float base, float step)
+    {
+        const __m128 bases = _mm_set1_ps(base);
+        const __m128 steps = _mm_set1_ps(step);
+        size_t i = 0;
+
+        for (; i + 4 <= count; i += 4) {
+            sse2RampStep(samples + i, index + i, bases, steps);
+        }
+
+        // The last samples go through the same computation.
+        if (i < count) {
+            float tail[4] = {};
+            std::memcpy(tail, samples + i, (count - i) * sizeof(float));
+            sse2RampStep(tail, index + i, bases, steps);
+            std::memcpy(samples + i, tail, (count - i) * sizeof(float));
+        }
+    }
+
+    __attribute__((target("sse2")))
+    void sse2Gain(float* samples, size_t count, float gain)
+    {
+        const __m128 gains = _mm_set1_ps(gain);
+        size_t i = 0;
+
+        for (; i + 4 <= count; i += 4) {
+            _mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), gains));
+        }
+
+        scalarGain(samples + i, count - i, gain);
+    }
+
+    __attribute__((target("sse2")))
+    void sse2ZeroFill(float* samples, size_t count)
+    {
+        const __m128 zeros = _mm_setzero_ps();
+        size_t i = 0;
+
+        for (; i + 4 <= count; i += 4) {
+            _mm_storeu_ps(samples + i, zeros);
+        }
+
+        scalarZeroFill(samples + i, count - i);
+    }
+
+    __attribute__((target("sse2")))
+    void sse2Copy(float* destination, const float* source, size_t count)
+    {
+        // Overlapping ranges are left to memmove.
+        if (destination < source + count && source < destination + count) {
+            scalarCopy(destination, source, count);
+            return;
+        }
+
+        size_t i = 0;
+
+        for (; i + 4 <= count; i += 4) {
+            _mm_storeu_ps(destination + i, _mm_loadu_ps(source + i));
+        }
+
+        scalarCopy(destination + i, source + i, count - i);
+    }
+
+    __attribute__((target("sse2")))
+    inline void sse2MixStep(float* destination, const float* source, __m128 gains)
+    {
+        _mm_storeu_ps(destination, _mm_add_ps(_mm_loadu_ps(destination), _mm_mul_ps(_mm_loadu_ps(source), gains)));
+    }
+
+    __attribute__((target("sse2")))
+    void sse2Mix(float* destination, const float* source, size_t count, float gain)
+    {
+        const __m128 gains = _mm_set1_ps(gain);
+        size_t i = 0;
+
+        for (; i + 4 <= count; i += 4) {
+            sse2MixStep(destination + i, source + i, gains);
+        }
+
+        if (i < count) {
+            float tailDestination[4] = {}, tailSource[4] = {};
+            std::memcpy(tailDestination, destination + i, (count - i) * sizeof(float));
+            std::memcpy(tailSource, source + i, (count - i) * sizeof(float));
+            sse2MixStep(tailDestination, tailSource, gains);
+            std::memcpy(destination + i, tailDestination, (count - i) * sizeof(float));
+        }
+    }
+
+    __attribute__((target("sse2")))
+    inline void sse2MixStereoStep(float* output, const float* left, const float* right, __m128 gains)
+    {
+        __m128 l = _mm_loadu_ps(left), r = _mm_loadu_ps(right);
+        // l0 r0 l1 r1, l2 r2 l3 r3
+        _mm_storeu_ps(output, _mm_add_ps(_mm_loadu_ps(output), _mm_mul_ps(_mm_unpacklo_ps(l, r), gains)));
+        _mm_storeu_ps(output + 4, _mm_add_ps(_mm_loadu_ps(output + 4), _mm_mul_ps(_mm_unpackhi_ps(l, r), gains)));
+    }
+
+    __attribute__((target("sse2")))
+    void sse2MixStereo(float* output, const float* left, const float* right, size_t count, float leftGain, float rightGain)
+    {
+        const __m128 gains = _mm_setr_ps(leftGain, rightGain, leftGain, rightGain);
+        size_t i = 0;
+
+        for (; i + 4 <= count; i += 4) {
+            sse2MixStereoStep(output + i * 2, left + i, right + i, gains);
+        }
+
+        if (i < count) {
+            float tailOutput[8] = {}, tailLeft[4] = {}, tailRight[4] = {};
+            std::memcpy(tailOutput, output + i * 2, (count - i) * 2 * sizeof(float));
+            std::memcpy(tailLeft, left + i, (count - i) * sizeof(float));
+            std::memcpy(tailRight, right + i, (count - i) * sizeof(float));
+            sse2MixStereoStep(tailOutput, tailLeft, tailRight, gains);
+            std::memcpy(output + i * 2, tailOutput, (count - i) * 2 * sizeof(float));
+        }
+    }
+
+    // --- AVX2 ---
+
+    bool avx2IsSupported() { return __builtin_cpu_supports("avx2"); }
+
+    __attribute__((target("avx2")))
+    inline void avx2RampStep(float* samples, size_t index, __m256 bases, __m256 steps)
+    {
+        const __m256i offsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        __m256i indexes = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int32_t>(index)), offsets);
+        __m256 gains = _mm256_add_ps(bases, _mm256_mul_ps(_mm256_cvtepi32_ps(indexes), steps));
+        _mm256_storeu_ps(samples, _mm256_mul_ps(_mm256_loadu_ps(samples), gains));
+    }
+
+    __attribute__((target("avx2")))
+    void avx2GainRamp(float* samples, size_t count, size_t index, float base, float step)
+    {
+        const __m256 bases = _mm256_set1_ps(base);
+        const __m256 steps = _mm256_set1_ps(step);
+        size_t i = 0;
+
+        for (; i + 8 <= count; i += 8) {
+            avx2RampStep(samples + i, index + i, bases, steps);
+        }
+
+        // The last samples go through the same computation.
+        if (i < count) {
+            float tail[8] = {};
+            std::memcpy(tail, samples + i, (count - i) * sizeof(float));
+            avx2RampStep(tail, index + i, bases, steps);
+            std::memcpy(samples + i, tail, (count - i) * sizeof(float));
+        }
+    }
+
+    __attribute__((target("avx2")))
+    void avx2Gain(float* samples, size_t count, float gain)
+    {
+        const __m256 gains = _mm256_set1_ps(gain);
+        size_t i = 0;
+
+        for (; i + 8 <= count; i += 8) {
+            _mm256_storeu_ps(samples + i, _mm256_mul_ps(_mm256_loadu_ps(samples + i), gains));
+        }
+
+        scalarGain(samples + i, count - i, gain);
+    }
+
+    __attribute__((target("avx2")))
+    void avx2ZeroFill(float* samples, size_t count)
+    {
+        const __m256 zeros = _mm256_setzero_ps();
+        size_t i = 0;
+
+        for (; i + 8 <= count; i += 8) {
+            _mm256_storeu_ps(samples + i, zeros);
+        }
+
+        scalarZeroFill(samples + i, count - i);
+    }
+
+    __attribute__((target("avx2")))
+    void avx2Copy(float* destination, const float* source, size_t count)
+    {
+        if (destination < source + count && source < destination + count) {
+            scalarCopy(destination, source, count);
+            return;
+        }
+
+        size_t i = 0;
+
+        for (; i + 8 <= count; i += 8) {
+            _mm256_storeu_ps(destination + i, _mm256_loadu_ps(source + i));
+        }
+
+        scalarCopy(destination + i, source + i, count - i);
+    }
+
+    __attribute__((target("avx2")))
+    inline void avx2MixStep(float* destination, const float* source, __m256 gains)
+    {
+        _mm256_storeu_ps(destination, _mm256_add_ps(_mm256_loadu_ps(destination), _mm256_mul_ps(_mm256_loadu_ps(source), gains)));
+    }
+
+    __attribute__((target("avx2")))
+    void avx2Mix(float* destination, const float* source, size_t count, float gain)
+    {
+        const __m256 gains = _mm256_set1_ps(gain);
+        size_t i = 0;
+
+        for (; i + 8 <= count; i += 8) {
+            avx2MixStep(destination + i, source + i, gains);
+        }
+
+        if (i < count) {
+            float tailDestination[8] = {}, tailSource[8] = {};
+            std::memcpy(tailDestination, destination + i, (count - i) * sizeof(float));
+            std::memcpy(tailSource, source + i, (count - i) * sizeof(float));
+            avx2MixStep(tailDestination, tailSource, gains);
+            std::memcpy(destination + i, tailDestination, (count - i) * sizeof(float));
+        }
+    }
+
+    __attribute__((target("avx2")))
+    inline void avx2MixStereoStep(float* output, const float* left, const float* right, __m256 gains)
+    {
+        __m256 l = _mm256_loadu_ps(left), r = _mm256_loadu_ps(right);
+        // The unpacking works within the 128 bit lanes: l0 r0 l1 r1 | l4 r4 l5 r5 and l2 r2 l3 r3 | l6 r6 l7 r7
+        __m256 low = _mm256_unpacklo_ps(l, r), high = _mm256_unpackhi_ps(l, r);
+        __m256 first = _mm256_permute2f128_ps(low, high, 0x20), second = _mm256_permute2f128_ps(low, high, 0x31);
+        _mm256_storeu_ps(output, _mm256_add_ps(_mm256_loadu_ps(output), _mm256_mul_ps(first, gains)));
+        _mm256_storeu_ps(output + 8, _mm256_add_ps(_mm256_loadu_ps(output + 8), _mm256_mul_ps(second, gains)));
+    }
+
+    __attribute__((target("avx2")))
+    void avx2MixStereo(float* output, const float* left, const float* right, size_t count, float leftGain, float rightGain)
+    {
+        const __m256 gains = _mm256_setr_ps(leftGain, rightGain, leftGain, rightGain, leftGain, rightGain, leftGain, rightGain);
+        size_t i = 0;
+
+        for (; i + 8 <= count; i += 8) {
+            avx2MixStereoStep(output + i * 2, left + i, right + i, gains);
+        }
+
+        if (i < count) {
+            float tailOutput[16] = {}, tailLeft[8] = {}, tailRight[8] = {};
+            std::memcpy(tailOutput, output + i * 2, (count - i) * 2 * sizeof(float));
+            std::memcpy(tailLeft, left + i, (count - i) * sizeof(float));
+            std::memcpy(tailRight, right + i, (count - i) * sizeof(float));
+            avx2MixStereoStep(tailOutput, tailLeft, tailRight, gains);
+            std::memcpy(output + i * 2, tailOutput, (count - i) * 2 * sizeof(float));
+        }
+    }
+
+    // --- AVX-512 ---
+
+    // GCC wrongly warns about the undefined source of some AVX-512 intrinsics.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+    bool avx512IsSupported() { return __builtin_cpu_supports("avx512f"); }
+
+    __attribute__((target("avx512f")))
+    inline void avx512RampStep(float* samples, size_t index, __m512 bases, __m512 steps)
+    {
+        const __m512i offsets = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        __m512i indexes = _mm512_add_epi32(_mm512_set1_epi32(static_cast<int32_t>(index)), offsets);
+        __m512 gains = _mm512_add_ps(bases, _mm512_mul_ps(_mm512_cvtepi32_ps(indexes), steps));
+        _mm512_storeu_ps(samples, _mm512_mul_ps(_mm512_loadu_ps(samples), gains));
+    }
+
+    __attribute__((target("avx512f")))
+    void avx512GainRamp(float* samples, size_t count, size_t index, float base, float step)
+    {
+        const __m512 bases = _mm512_set1_ps(base);
+        const __m512 steps = _mm512_set1_ps(step);
+        size_t i = 0;
+
+        for (; i + 16 <= count; i += 16) {
+            avx512RampStep(samples + i, index + i, bases, steps);
+        }
+
+        // The last samples go through the same computation.
+        if (i < count) {
+            float tail[16] = {};
+            std::memcpy(tail, samples + i, (count - i) * sizeof(float));
+            avx512RampStep(tail, index + i, bases, steps);
+            std::memcpy(samples + i, tail, (count - i) * sizeof(float));
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    void avx512Gain(float* samples, size_t count, float gain)
+    {
+        const __m512 gains = _mm512_set1_ps(gain);
+        size_t i = 0;
+
+        for (; i + 16 <= count; i += 16) {
+            _mm512_storeu_ps(samples + i, _mm512_mul_ps(_mm512_loadu_ps(samples + i), gains));
+        }
+
+        scalarGain(samples + i, count - i, gain);
+    }
+
+    __attribute__((target("avx512f")))
+    void avx512ZeroFill(float* samples, size_t count)
+    {
+        const __m512 zeros = _mm512_setzero_ps();
+        size_t i = 0;
+
+        for (; i + 16 <= count; i += 16) {
+            _mm512_storeu_ps(samples + i, zeros);
+        }
+
+        scalarZeroFill(samples + i, count - i);
+    }
+
+    __attribute__((target("avx512f")))
+    void avx512Copy(float* destination, const float* source, size_t count)
+    {
+        if (destination < source + count && source < destination + count) {
+            scalarCopy(destination, source, count);
+            return;
+        }
+
+        size_t i = 0;
+
+        for (; i + 16 <= count; i += 16) {
+            _mm512_storeu_ps(destination + i, _mm512_loadu_ps(source + i));
+        }
+
+        scalarCopy(destination + i, source + i, count - i);
+    }
+
+    __attribute__((target("avx512f")))
+    inline void avx512MixStep(float* destination, const float* source, __m512 gains)
+    {
+        _mm512_storeu_ps(destination, _mm512_add_ps(_mm512_loadu_ps(destination), _mm512_mul_ps(_mm512_loadu_ps(source), gains)));
+    }
+
+    __attribute__((target("avx512f")))
+    void avx512Mix(float* destination, const float* source, size_t count, float gain)
+    {
+        const __m512 gains = _mm512_set1_ps(gain);
+        size_t i = 0;
+
+        for (; i + 16 <= count; i += 16) {
+            avx512MixStep(destination + i, source + i, gains);
+        }
+
+        if (i < count) {
+            float tailDestination[16] = {}, tailSource[16] = {};
+            std::memcpy(tailDestination, destination + i, (count - i) * sizeof(float));
+            std::memcpy(tailSource, source + i, (count - i) * sizeof(float));
+            avx512MixStep(tailDestination, tailSource, gains);
+            std::memcpy(destination + i, tailDestination, (count - i) * sizeof(float));
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    inline void avx512MixStereoStep(float* output, const float* left, const float* right, __m512 gains)
+    {
+        // Lanes of the low (0-15) and high (16-31) unpacked vectors in the interleaved order.
+        const __m512i firstLanes = _mm512_setr_epi32(0, 1, 2, 3, 16, 17, 18, 19, 4, 5, 6, 7, 20, 21, 22, 23);
+        const __m512i secondLanes = _mm512_setr_epi32(8, 9, 10, 11, 24, 25, 26, 27, 12, 13, 14, 15, 28, 29, 30, 31);
+        __m512 l = _mm512_loadu_ps(left), r = _mm512_loadu_ps(right);
+        __m512 low = _mm512_unpacklo_ps(l, r), high = _mm512_unpackhi_ps(l, r);
+        __m512 first = _mm512_permutex2var_ps(low, firstLanes, high), second = _mm512_permutex2var_ps(low, secondLanes, high);
+        _mm512_storeu_ps(output, _mm512_add_ps(_mm512_loadu_ps(output), _mm512_mul_ps(first, gains)));
+        _mm512_storeu_ps(output + 16, _mm512_add_ps(_mm512_loadu_ps(output + 16), _mm512_mul_ps(second, gains)));
+    }
+
+    __attribute__((target("avx512f")))
+    void avx512MixStereo(float* output, const float* left, const float* right, size_t count, float leftGain, float rightGain)
+    {
+        const __m512 gains = _mm512_setr_ps(leftGain, rightGain, leftGain, rightGain, leftGain, rightGain, leftGain, rightGain,
+                                             leftGain, rightGain, leftGain, rightGain, leftGain, rightGain, leftGain, rightGain);
+        size_t i = 0;
+
+        for (; i + 16 <= count; i += 16) {
+            avx512MixStereoStep(output + i * 2, left + i, right + i, gains);
+        }
+
+        if (i < count) {
+            float tailOutput[32] = {}, tailLeft[16] = {}, tailRight[16] = {};
+            std::memcpy(tailOutput, output + i * 2, (count - i) * 2 * sizeof(float));
+            std::memcpy(tailLeft, left + i, (count - i) * sizeof(float));
+            std::memcpy(tailRight, right + i, (count - i) * sizeof(float));
+            avx512MixStereoStep(tailOutput, tailLeft, tailRight, gains);
+            std::memcpy(output + i * 2, tailOutput, (count - i) * 2 * sizeof(float));
+        }
+    }
+#pragma GCC diagnostic pop
+#endif
+
+    // From the most to the least efficient.
+    const Kernels::Variant variants[] = {
+#ifdef KERNELS_X86
+        {"AVX-512", avx512IsSupported, avx512GainRamp, avx512Gain, avx512ZeroFill, avx512Copy, avx512Mix, avx512MixStereo},
+        {"AVX2", avx2IsSupported, avx2GainRamp, avx2Gain, avx2ZeroFill, avx2Copy, avx2Mix, avx2MixStereo},
+        {"SSE2", sse2IsSupported, sse2GainRamp, sse2Gain, sse2ZeroFill, sse2Copy, sse2Mix, sse2MixStereo},
+#endif
+        {"Scalar", scalarIsSupported, scalarGainRamp, scalarGain, scalarZeroFill, scalarCopy, scalarMix, scalarMixStereo}
+    };
+}
+
+/*
+ * Returns the most efficient variant supported by the CPU (picked once).
+ */
+const Kernels::Variant& Kernels::getVariant()
+{
+    static const Variant& variant = *getSupportedVariants().front();
+
+    return variant;
+}
+
+std::vector<const Kernels::Variant*> Kernels::getSupportedVariants()
+{
+    std::vector<const Variant*> supported;
+
+    for (const auto& variant : variants) {
+        if (variant.isSupported()) {
+            supported.push_back(&variant);
+        }
+    }
+
+    return supported;
+}
+
+/*
+ * Prints the throughput of each kernel for each variant supported by the CPU.
+ */
+void Kernels::benchmark()
+{
+    // 2 seconds of a 48kHz channel: Small enough to stay in the cache.
+    const size_t count = 96000;
+    const int runs = 2000;
+    std::vector<float> destination(count, 0.5f), source(count, 0.25f);
+
+    std::cout << "Kernel throughput (Msamples/s), current variant: " << getVariantName() << std::endl;
+    std::cout << std::left << std::setw(10) << "Variant" << std::right << std::setw(10) << "Ramp"
+              << std::setw(10) << "Gain" << std::setw(10) << "Zero" << std::setw(10) << "Copy" << std::setw(10) << "Mix" << std::setw(10) << "Stereo" << std::endl;
+
+    for (auto variant : getSupportedVariants()) {
+        auto measure = [&](auto&& kernel) {
+            auto start = std::chrono::steady_clock::now();
+
+            for (int run = 0; run < runs; run++) {
+                kernel();
+            }
+
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+            return static_cast<double>(count) * runs / elapsed.count() / 1e6;
+        };
+
+        // The gains are close to 1.0 so the values neither vanish nor blow up over the runs.
+        double ramp = measure([&] { variant->gainRamp(destination.data(), count, 0, 1.0f, 1e-9f); });
+        double gain = measure([&] { variant->gain(destination.data(), count, 0.999999f); });
+        double zero = measure([&] { variant->zeroFill(destination.data(), count); });
+        double copy = measure([&] { variant->copy(destination.data(), source.data(), count); });
+        double mix = measure([&] { variant->mix(destination.data(), source.data(), count, 1e-6f); });
+        // Half as many frames, so the same number of samples.
+        double stereo = measure([&] { variant->mixStereo(destination.data(), source.data(), source.data() + count / 2, count / 2, 1e-6f, 1e-6f); });
+
+        std::cout << std::left << std::setw(10) << variant->name << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(10) << ramp << std::setw(10) << gain << std::setw(10) << zero
+                  << std::setw(10) << copy << std::setw(10) << mix << std::setw(10) << stereo << std::endl;
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cstddef>
+#include <vector>
+
+/*
+ * Vectorized loops applied to ranges of samples (gain, fades, mixing...).
+ * Each kernel comes in several variants (scalar, SSE2, AVX2, AVX-512) and the best one
+ * the CPU supports is picked at runtime.
+ */
+class Kernels {
+    public:
+        struct Variant {
+            const char* name;
+            bool (*isSupported)();
+            // samples[i] *= base + (index + i) * step
+            void (*gainRamp)(float* samples, size_t count, size_t index, float base, float step);
+            // samples[i] *= gain
+            void (*gain)(float* samples, size_t count, float gain);
+            // samples[i] = 0
+            void (*zeroFill)(float* samples, size_t count);
+            // destination[i] = source[i]
+            void (*copy)(float* destination, const float* source, size_t count);
+            // destination[i] += source[i] * gain
+            void (*mix)(float* destination, const float* source, size_t count, float gain);
+            // output[i * 2] += left[i] * leftGain, output[i * 2 + 1] += right[i] * rightGain
+            void (*mixStereo)(float* output, const float* left, const float* right, size_t count, float leftGain, float rightGain);
+        };
+
+    private:
+        static const Variant& getVariant();
+
+    public:
+        /*
+         * Multiplies the samples by a linear ramp. The gain of a sample depends only on its
+         * index, so a range can be processed in several parts with the very same result.
+         */
+        static void gainRamp(float* samples, size_t count, size_t index, float base, float step) {
+            getVariant().gainRamp(samples, count, index, base, step);
+        }
+
+        static void gain(float* samples, size_t count, float gain) { getVariant().gain(samples, count, gain); }
+        static void zeroFill(float* samples, size_t count) { getVariant().zeroFill(samples, count); }
+        static void copy(float* destination, const float* source, size_t count) { getVariant().copy(destination, source, count); }
+        static void mix(float* destination, const float* source, size_t count, float gain) {
+            getVariant().mix(destination, source, count, gain);
+        }
+
+        /*
+         * Adds the planar left and right samples to an interleaved stereo buffer (ie: playback).
+         */
+        static void mixStereo(float* output, const float* left, const float* right, size_t count, float leftGain, float rightGain) {
+            getVariant().mixStereo(output, left, right, count, leftGain, rightGain);
+        }
+
+        static const char* getVariantName() { return getVariant().name; }
+        static std::vector<const Variant*> getSupportedVariants();
+        static void benchmark();
+};
+
+#endif // KERNELS_H
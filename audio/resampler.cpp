@@ -0,0 +1,257 @@
+#include "resampler.h"
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+namespace {
+    // Modified Bessel function of the first kind (order 0), used by the Kaiser window.
+    double besselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+
+        for (int k = 1; k < 50; k++) {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+
+            if (term < sum * 1e-12) {
+                break;
+            }
+        }
+
+        return sum;
+    }
+
+    double sinc(double x)
+    {
+        return std::fabs(x) < 1e-9 ? 1.0 : std::sin(M_PI * x) / (M_PI * x);
+    }
+}
+
+const char* Resampler::getQualityName(Quality quality)
+{
+    switch (quality) {
+        case Quality::LINEAR:
+            return "Linear";
+        case Quality::STANDARD:
+            return "Standard";
+        case Quality::HIGH:
+            return "High";
+    }
+
+    return "";
+}
+
+/*
+ * Computes the filter table for the given rates. Must be called before the audio thread
+ * uses the resampler as the buffers are allocated here.
+ */
+void Resampler::configure(uint32_t input, uint32_t output, Quality quality, size_t maxBlockSize)
+{
+    inputRate = input;
+    outputRate = output;
+
+    if (!isActive()) {
+        table.clear();
+        sourceLeft.clear();
+        sourceRight.clear();
+        return;
+    }
+
+    // Taps, Kaiser window shape and passband (as a part of the lowest Nyquist frequency).
+    double beta = 0.0, passband = 1.0;
+
+    switch (quality) {
+        case Quality::LINEAR:
+            taps = 2;
+            break;
+        case Quality::STANDARD:
+            taps = 16;
+            beta = 6.0;
+            passband = 0.90;
+            break;
+        case Quality::HIGH:
+            taps = 64;
+            beta = 9.0;
+            passband = 0.95;
+            break;
+    }
+
+    // Downsampling: The cutoff drops with the output rate, which stretches the filter
+    // by the same ratio. The taps follow, so the stopband is the same whatever the rates.
+    if (quality != Quality::LINEAR && input > output) {
+        unsigned int scaled = static_cast<unsigned int>(std::ceil(taps * static_cast<double>(input) / output / 2.0)) * 2;
+        taps = std::min(scaled, MAX_TAPS);
+    }
+
+    step = (static_cast<uint64_t>(input) << 32) / output;
+    // Downsampling: The frequencies above the output Nyquist frequency are filtered out.
+    double cutoff = passband * std::min(1.0, static_cast<double>(output) / input);
+    int half = static_cast<int>(taps / 2);
+    table.assign(static_cast<size_t>(PHASES + 1) * taps, 0.0f);
+
+    for (unsigned int p = 0; p <= PHASES; p++) {
+        float* row = table.data() + static_cast<size_t>(p) * taps;
+        double offset = static_cast<double>(p) / PHASES;
+        double sum = 0.0;
+
+        for (unsigned int k = 0; k < taps; k++) {
+            // Distance between the tap and the interpolated point.
+            double distance = static_cast<double>(static_cast<int>(k) - half + 1) - offset;
+            double value = 0.0;
+
+            if (quality == Quality::LINEAR) {
+                value = std::max(0.0, 1.0 - std::fabs(distance));
+            }
+            else if (std::fabs(distance) < half) {
+                double ratio = distance / half;
+                double window = besselI0(beta * std::sqrt(1.0 - ratio * ratio)) / besselI0(beta);
+                value = cutoff * sinc(cutoff * distance) * window;
+            }
+
+            row[k] = static_cast<float>(value);
+            sum += value;
+        }
+
+        // Unity gain at DC for every phase.
+        for (unsigned int k = 0; k < taps && sum != 0.0; k++) {
+            row[k] = static_cast<float>(row[k] / sum);
+        }
+    }
+
+    blockSize = maxBlockSize;
+    size_t capacity = static_cast<size_t>((static_cast<unsigned __int128>(maxBlockSize) * step) >> 32) + taps + 2;
+    sourceLeft.assign(capacity, 0.0f);
+    sourceRight.assign(capacity, 0.0f);
+}
+
+/*
+ * Computes up to count output frames from the given source position (frame + 32 bit fraction)
+ * and moves the position forward. Stops before the position reaches the stop frame.
+ * Returns the number of output frames computed.
+ */
+size_t Resampler::process(size_t& position, uint32_t& fraction, size_t count, size_t stopFrame,
+                          float* left, float* right, const SourceReader& source)
+{
+    if (position >= stopFrame) {
+        return 0;
+    }
+
+    uint64_t start = (static_cast<uint64_t>(position) << 32) | fraction;
+    // The number of output frames before the stop frame.
+    uint64_t available = ((static_cast<uint64_t>(stopFrame) << 32) - start + step - 1) / step;
+    count = static_cast<size_t>(std::min<uint64_t>({count, blockSize, available}));
+
+    if (count == 0) {
+        return 0;
+    }
+
+    // Read the source frames covered by the filter over the whole block.
+    const int half = static_cast<int>(taps / 2);
+    const int64_t first = static_cast<int64_t>(position) - half + 1;
+    const size_t lastIndex = static_cast<size_t>((start + (count - 1) * step) >> 32);
+    const size_t needed = lastIndex - position + taps;
+    std::fill(sourceLeft.begin(), sourceLeft.begin() + needed, 0.0f);
+    std::fill(sourceRight.begin(), sourceRight.begin() + needed, 0.0f);
+
+    // The frames before the start of the track are left to zero.
+    size_t skipped = first < 0 ? static_cast<size_t>(-first) : 0;
+    source(static_cast<size_t>(first + static_cast<int64_t>(skipped)), needed - skipped,
+           sourceLeft.data() + skipped, sourceRight.data() + skipped);
+
+    for (size_t i = 0; i < count; i++) {
+        uint64_t current = start + i * step;
+        size_t offset = static_cast<size_t>((current >> 32) - position);
+        uint32_t phaseFraction = static_cast<uint32_t>(current);
+        // The top bits give the phase, the other ones the interpolation between 2 phases.
+        uint32_t phase = phaseFraction >> 24;
+        float t = static_cast<float>(phaseFraction & 0xFFFFFF) * (1.0f / 16777216.0f);
+        const float* row = table.data() + static_cast<size_t>(phase) * taps;
+        const float* nextRow = row + taps;
+        const float* l = sourceLeft.data() + offset;
+        const float* r = sourceRight.data() + offset;
+        float sumLeft = 0.0f, sumRight = 0.0f, nextLeft = 0.0f, nextRight = 0.0f;
+
+        for (unsigned int k = 0; k < taps; k++) {
+            sumLeft += l[k] * row[k];
+            sumRight += r[k] * row[k];
+            nextLeft += l[k] * nextRow[k];
+            nextRight += r[k] * nextRow[k];
+        }
+
+        left[i] = sumLeft + (nextLeft - sumLeft) * t;
+        right[i] = sumRight + (nextRight - sumRight) * t;
+    }
+
+    uint64_t end = start + count * step;
+    position = static_cast<size_t>(end >> 32);
+    fraction = static_cast<uint32_t>(end);
+
+    return count;
+}
+
+/*
+ * Prints the speed (as a multiple of real time) and the signal to noise ratio of each quality
+ * for common rate conversions.
+ */
+void Resampler::benchmark()
+{
+    const uint32_t conversions[][2] = {{48000, 44100}, {96000, 44100}, {44100, 48000}};
+    const Quality qualities[] = {Quality::LINEAR, Quality::STANDARD, Quality::HIGH};
+    const size_t block = 256;
+    const double frequency = 1000.0;
+
+    std::cout << "Resampler speed (x real time) and SNR (dB) of a 1 kHz sine" << std::endl;
+    std::cout << std::left << std::setw(18) << "Conversion" << std::setw(10) << "Quality" << std::right
+              << std::setw(6) << "Taps" << std::setw(12) << "Speed" << std::setw(10) << "SNR" << std::endl;
+
+    for (const auto& conversion : conversions) {
+        // 10 seconds of source.
+        size_t inputFrames = conversion[0] * 10;
+        std::vector<float> input(inputFrames);
+
+        for (size_t i = 0; i < inputFrames; i++) {
+            input[i] = static_cast<float>(0.5 * std::sin(2.0 * M_PI * frequency * i / conversion[0]));
+        }
+
+        auto source = [&](size_t start, size_t count, float* l, float* r) {
+            size_t n = start < inputFrames ? std::min(count, inputFrames - start) : 0;
+            std::copy(input.begin() + start, input.begin() + start + n, l);
+            std::copy(input.begin() + start, input.begin() + start + n, r);
+            return n;
+        };
+
+        for (auto quality : qualities) {
+            Resampler resampler;
+            resampler.configure(conversion[0], conversion[1], quality, block);
+            std::vector<float> left(block), right(block), output;
+            output.reserve(static_cast<size_t>(conversion[1]) * 10 + block);
+            size_t position = 0;
+            uint32_t fraction = 0;
+
+            auto begin = std::chrono::steady_clock::now();
+
+            while (size_t count = resampler.process(position, fraction, block, inputFrames, left.data(), right.data(), source)) {
+                output.insert(output.end(), left.begin(), left.begin() + count);
+            }
+
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+            // Compare with the ideal sine, the edges (ie: filter warm up) excepted.
+            double signal = 0.0, noise = 0.0;
+
+            for (size_t i = 1000; i + 1000 < output.size(); i++) {
+                double expected = 0.5 * std::sin(2.0 * M_PI * frequency * i / conversion[1]);
+                signal += expected * expected;
+                noise += (output[i] - expected) * (output[i] - expected);
+            }
+
+            std::string name = std::to_string(conversion[0]) + " > " + std::to_string(conversion[1]);
+            std::cout << std::left << std::setw(18) << name << std::setw(10) << getQualityName(quality) << std::right
+                      << std::setw(6) << resampler.getTaps() << std::fixed << std::setprecision(0)
+                      << std::setw(12) << 10.0 / elapsed.count() << std::setprecision(1)
+                      << std::setw(10) << 10.0 * std::log10(signal / std::max(noise, 1e-30)) << std::endl;
+        }
+    }
+}
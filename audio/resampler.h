@@ -0,0 +1,54 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+/*
+ * Converts the samples of a track to the output sample rate as they are played.
+ * Output samples are interpolated with a windowed sinc filter stored as a table of phases
+ * (ie: polyphase), the number of taps depending on the quality (and on the rate ratio
+ * when downsampling).
+ * The source frames are read on demand around the playback position, so the resampler keeps
+ * no history and playback can jump anywhere (eg: loops, cursor moves).
+ */
+class Resampler {
+    public:
+        enum class Quality { LINEAR, STANDARD, HIGH };
+
+        // Reads the frames to resample.
+        using SourceReader = std::function<size_t(size_t start, size_t count, float* left, float* right)>;
+
+    private:
+        // Number of phases between 2 source frames (the gaps are interpolated).
+        static constexpr unsigned int PHASES = 256;
+        // Limits the filter length on steep downsampling ratios.
+        static constexpr unsigned int MAX_TAPS = 512;
+
+        uint32_t inputRate = 0;
+        uint32_t outputRate = 0;
+        unsigned int taps = 2;
+        // Position increment per output frame (32.32 fixed point).
+        uint64_t step = 0;
+        // Filter coefficients: (PHASES + 1) rows of taps.
+        std::vector<float> table;
+        // Source frames around the current block (allocated once, used by the audio thread only).
+        std::vector<float> sourceLeft;
+        std::vector<float> sourceRight;
+        size_t blockSize = 0;
+
+    public:
+        void configure(uint32_t input, uint32_t output, Quality quality, size_t maxBlockSize);
+        size_t process(size_t& position, uint32_t& fraction, size_t count, size_t stopFrame,
+                       float* left, float* right, const SourceReader& source);
+
+        // Getters.
+        bool isActive() const { return inputRate != outputRate && inputRate != 0 && outputRate != 0; }
+        unsigned int getTaps() const { return taps; }
+        static const char* getQualityName(Quality quality);
+        static void benchmark();
+};
+
+#endif // RESAMPLER_H
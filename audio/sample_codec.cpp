@@ -0,0 +1,444 @@
+#include "sample_codec.h"
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+namespace {
+    // Number of residuals sharing the same Rice parameter.
+    constexpr size_t RICE_PARTITION_SIZE = 256;
+    // Quotients from this value on are followed by the raw residual.
+    constexpr uint32_t RICE_ESCAPE = 24;
+    // Residuals of 16-bit samples fit in 17 bits once zigzagged.
+    constexpr unsigned int RICE_RAW_BITS = 17;
+
+    uint32_t floatBits(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    float bitsFloat(uint32_t bits)
+    {
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    uint32_t zigzag(int32_t value) { return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31); }
+    int32_t unzigzag(uint32_t value) { return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1); }
+
+    /*
+     * Writes values bit by bit, most significant bit first.
+     */
+    class BitWriter {
+            std::vector<uint8_t>& out;
+            uint64_t accumulator = 0;
+            unsigned int bits = 0;
+
+        public:
+            BitWriter(std::vector<uint8_t>& o) : out(o) {}
+
+            void put(uint32_t value, unsigned int count) {
+                accumulator = (accumulator << count) | value;
+                bits += count;
+
+                while (bits >= 8) {
+                    bits -= 8;
+                    out.push_back(static_cast<uint8_t>(accumulator >> bits));
+                }
+
+                accumulator &= (1ull << bits) - 1;
+            }
+
+            void flush() {
+                if (bits > 0) {
+                    out.push_back(static_cast<uint8_t>(accumulator << (8 - bits)));
+                    accumulator = 0;
+                    bits = 0;
+                }
+            }
+    };
+
+    class BitReader {
+            const uint8_t* data;
+            size_t size;
+            size_t position = 0;
+            uint64_t accumulator = 0;
+            unsigned int bits = 0;
+
+        public:
+            BitReader(const uint8_t* d, size_t s) : data(d), size(s) {}
+
+            uint32_t get(unsigned int count) {
+                while (bits < count) {
+                    if (position >= size) {
+                        throw std::runtime_error("Truncated compressed samples.");
+                    }
+
+                    accumulator = (accumulator << 8) | data[position++];
+                    bits += 8;
+                }
+
+                bits -= count;
+                uint32_t value = static_cast<uint32_t>((accumulator >> bits) & ((1ull << count) - 1));
+                accumulator &= (1ull << bits) - 1;
+
+                return value;
+            }
+    };
+
+    /*
+     * Checks whether the samples were converted from 16-bit integers and returns these integers if so.
+     */
+    bool toPcm16(const float* samples, size_t count, std::vector<int32_t>& values)
+    {
+        values.resize(count);
+
+        for (size_t i = 0; i < count; i++) {
+            float scaled = samples[i] * 32768.0f;
+
+            if (!(scaled >= -32768.0f && scaled <= 32767.0f)) {
+                return false;
+            }
+
+            int32_t value = static_cast<int32_t>(std::lrint(scaled));
+
+            // Must be decoded back to the very same bits (eg: -0.0 doesn't qualify).
+            if (floatBits(static_cast<float>(value) / 32768.0f) != floatBits(samples[i])) {
+                return false;
+            }
+
+            values[i] = value;
+        }
+
+        return true;
+    }
+
+    /*
+     * Returns the Rice parameter of the given residuals, ie: about the log2 of their mean.
+     */
+    unsigned int riceParameter(const uint32_t* residuals, size_t count)
+    {
+        uint64_t sum = 0;
+
+        for (size_t i = 0; i < count; i++) {
+            sum += residuals[i];
+        }
+
+        uint64_t mean = sum / count;
+        unsigned int k = 0;
+
+        while (k < RICE_RAW_BITS && (2ull << k) <= mean) {
+            k++;
+        }
+
+        return k;
+    }
+
+    void putRice(BitWriter& writer, uint32_t residual, unsigned int k)
+    {
+        uint32_t quotient = residual >> k;
+
+        if (quotient >= RICE_ESCAPE) {
+            writer.put((1u << RICE_ESCAPE) - 1, RICE_ESCAPE);
+            writer.put(residual, RICE_RAW_BITS);
+            return;
+        }
+
+        // Unary quotient followed by the k low bits.
+        writer.put(((1u << quotient) - 1) << 1, quotient + 1);
+
+        if (k > 0) {
+            writer.put(residual & ((1u << k) - 1), k);
+        }
+    }
+
+    uint32_t getRice(BitReader& reader, unsigned int k)
+    {
+        uint32_t quotient = 0;
+
+        while (quotient < RICE_ESCAPE && reader.get(1)) {
+            quotient++;
+        }
+
+        if (quotient == RICE_ESCAPE) {
+            return reader.get(RICE_RAW_BITS);
+        }
+
+        return (quotient << k) | (k > 0 ? reader.get(k) : 0);
+    }
+
+    void encodeRice(const std::vector<int32_t>& values, std::vector<uint8_t>& out)
+    {
+        BitWriter writer(out);
+        std::vector<uint32_t> residuals(values.size());
+        int32_t previous = 0;
+
+        for (size_t i = 0; i < values.size(); i++) {
+            residuals[i] = zigzag(values[i] - previous);
+            previous = values[i];
+        }
+
+        for (size_t start = 0; start < residuals.size(); start += RICE_PARTITION_SIZE) {
+            size_t end = std::min(start + RICE_PARTITION_SIZE, residuals.size());
+            unsigned int k = riceParameter(residuals.data() + start, end - start);
+            writer.put(k, 5);
+
+            for (size_t i = start; i < end; i++) {
+                putRice(writer, residuals[i], k);
+            }
+        }
+
+        writer.flush();
+    }
+
+    void decodeRice(const uint8_t* data, size_t size, float* samples, size_t count)
+    {
+        BitReader reader(data, size);
+        int32_t previous = 0;
+
+        for (size_t start = 0; start < count; start += RICE_PARTITION_SIZE) {
+            size_t end = std::min(start + RICE_PARTITION_SIZE, count);
+            unsigned int k = reader.get(5);
+
+            for (size_t i = start; i < end; i++) {
+                previous += unzigzag(getRice(reader, k));
+                samples[i] = static_cast<float>(previous) / 32768.0f;
+            }
+        }
+    }
+
+    /*
+     * XORs each sample with the previous one. Close samples share their sign, exponent and
+     * high mantissa bits, so the result starts with zeros. Only its significant bits are kept
+     * (the highest one excepted as it's always set) along with their count, which is Rice
+     * coded as it changes little from one sample to the next.
+     * The trailing zeros common to a partition (eg: samples of 24-bit origin) are dropped too.
+     */
+    void encodeXor(const float* samples, size_t count, std::vector<uint8_t>& out)
+    {
+        BitWriter writer(out);
+        std::vector<uint32_t> values(count);
+        uint32_t previous = 0;
+
+        for (size_t i = 0; i < count; i++) {
+            uint32_t bits = floatBits(samples[i]);
+            values[i] = bits ^ previous;
+            previous = bits;
+        }
+
+        std::vector<uint32_t> residuals(RICE_PARTITION_SIZE);
+        unsigned int previousLength = 0;
+
+        for (size_t start = 0; start < count; start += RICE_PARTITION_SIZE) {
+            size_t end = std::min(start + RICE_PARTITION_SIZE, count);
+            uint32_t any = 0;
+
+            for (size_t i = start; i < end; i++) {
+                any |= values[i];
+            }
+
+            unsigned int shift = any ? __builtin_ctz(any) : 0;
+            unsigned int length = previousLength;
+
+            for (size_t i = start; i < end; i++) {
+                values[i] >>= shift;
+                unsigned int current = values[i] ? 32 - __builtin_clz(values[i]) : 0;
+                residuals[i - start] = zigzag(static_cast<int32_t>(current) - static_cast<int32_t>(length));
+                length = current;
+            }
+
+            unsigned int k = riceParameter(residuals.data(), end - start);
+            writer.put(shift, 5);
+            writer.put(k, 5);
+
+            for (size_t i = start; i < end; i++) {
+                putRice(writer, residuals[i - start], k);
+                length = values[i] ? 32 - __builtin_clz(values[i]) : 0;
+
+                if (length > 1) {
+                    writer.put(values[i] & ((1u << (length - 1)) - 1), length - 1);
+                }
+            }
+
+            previousLength = length;
+        }
+
+        writer.flush();
+    }
+
+    void decodeXor(const uint8_t* data, size_t size, float* samples, size_t count)
+    {
+        BitReader reader(data, size);
+        uint32_t previous = 0;
+        int32_t length = 0;
+
+        for (size_t start = 0; start < count; start += RICE_PARTITION_SIZE) {
+            size_t end = std::min(start + RICE_PARTITION_SIZE, count);
+            unsigned int shift = reader.get(5);
+            unsigned int k = reader.get(5);
+
+            for (size_t i = start; i < end; i++) {
+                length += unzigzag(getRice(reader, k));
+
+                if (length < 0 || length + shift > 32) {
+                    throw std::runtime_error("Corrupted compressed samples.");
+                }
+
+                if (length > 0) {
+                    uint32_t value = (1u << (length - 1)) | (length > 1 ? reader.get(length - 1) : 0);
+                    previous ^= value << shift;
+                }
+
+                samples[i] = bitsFloat(previous);
+            }
+        }
+    }
+}
+
+/*
+ * Appends the mode, the payload size and the payload of the given channel samples.
+ */
+void SampleCodec::encodeChannel(const float* samples, size_t count, std::vector<uint8_t>& out)
+{
+    size_t header = out.size();
+    out.resize(header + 1 + sizeof(uint32_t));
+    Mode mode;
+
+    std::vector<int32_t> values;
+
+    if (std::all_of(samples, samples + count, [](float sample) { return floatBits(sample) == 0; })) {
+        mode = SILENCE;
+    }
+    else if (toPcm16(samples, count, values)) {
+        mode = PCM16;
+        encodeRice(values, out);
+    }
+    else {
+        mode = XOR;
+        encodeXor(samples, count, out);
+    }
+
+    // Fall back on the raw samples when coding doesn't pay off.
+    if (out.size() - header - 1 - sizeof(uint32_t) > count * sizeof(float)) {
+        mode = RAW;
+        out.resize(header + 1 + sizeof(uint32_t) + count * sizeof(float));
+        std::memcpy(out.data() + header + 1 + sizeof(uint32_t), samples, count * sizeof(float));
+    }
+
+    uint32_t payload = static_cast<uint32_t>(out.size() - header - 1 - sizeof(uint32_t));
+    out[header] = mode;
+    std::memcpy(out.data() + header + 1, &payload, sizeof(payload));
+}
+
+/*
+ * Decodes the given number of channel samples and returns the number of bytes read.
+ */
+size_t SampleCodec::decodeChannel(const uint8_t* data, size_t size, float* samples, size_t count, const float* left)
+{
+    uint32_t payload;
+
+    if (size < 1 + sizeof(payload)) {
+        throw std::runtime_error("Truncated compressed samples.");
+    }
+
+    Mode mode = static_cast<Mode>(data[0]);
+    std::memcpy(&payload, data + 1, sizeof(payload));
+    data += 1 + sizeof(payload);
+
+    if (payload > size - 1 - sizeof(payload)) {
+        throw std::runtime_error("Truncated compressed samples.");
+    }
+
+    switch (mode) {
+        case SILENCE:
+            std::fill_n(samples, count, 0.0f);
+            break;
+
+        case PCM16:
+            decodeRice(data, payload, samples, count);
+            break;
+
+        case XOR:
+            decodeXor(data, payload, samples, count);
+            break;
+
+        case SAME:
+            if (left == nullptr) {
+                throw std::runtime_error("Corrupted compressed samples.");
+            }
+
+            std::copy_n(left, count, samples);
+            break;
+
+        case RAW:
+            if (payload != count * sizeof(float)) {
+                throw std::runtime_error("Corrupted compressed samples.");
+            }
+
+            std::memcpy(samples, data, payload);
+            break;
+
+        default:
+            throw std::runtime_error("Unknown sample compression mode.");
+    }
+
+    return 1 + sizeof(payload) + payload;
+}
+
+/*
+ * Compresses the given samples chunk by chunk.
+ */
+std::vector<uint8_t> SampleCodec::encode(const SampleStore& samples)
+{
+    std::vector<uint8_t> out;
+    uint64_t frameCount = samples.size();
+    out.resize(sizeof(frameCount));
+    std::memcpy(out.data(), &frameCount, sizeof(frameCount));
+
+    std::vector<float> left(SAMPLE_BLOCK_SIZE), right(SAMPLE_BLOCK_SIZE);
+
+    for (size_t position = 0; position < frameCount; position += SAMPLE_BLOCK_SIZE) {
+        size_t count = samples.read(position, SAMPLE_BLOCK_SIZE, left.data(), right.data());
+        encodeChannel(left.data(), count, out);
+
+        if (std::memcmp(left.data(), right.data(), count * sizeof(float)) == 0) {
+            uint32_t payload = 0;
+            out.push_back(SAME);
+            out.insert(out.end(), reinterpret_cast<uint8_t*>(&payload), reinterpret_cast<uint8_t*>(&payload) + sizeof(payload));
+        }
+        else {
+            encodeChannel(right.data(), count, out);
+        }
+    }
+
+    out.shrink_to_fit();
+
+    return out;
+}
+
+SampleStore SampleCodec::decode(const std::vector<uint8_t>& data)
+{
+    SampleStore samples;
+    uint64_t frameCount;
+
+    if (data.size() < sizeof(frameCount)) {
+        throw std::runtime_error("Truncated compressed samples.");
+    }
+
+    std::memcpy(&frameCount, data.data(), sizeof(frameCount));
+    size_t offset = sizeof(frameCount);
+
+    std::vector<float> left(SAMPLE_BLOCK_SIZE), right(SAMPLE_BLOCK_SIZE);
+
+    for (size_t position = 0; position < frameCount; position += SAMPLE_BLOCK_SIZE) {
+        size_t count = std::min(static_cast<uint64_t>(SAMPLE_BLOCK_SIZE), frameCount - position);
+        offset += decodeChannel(data.data() + offset, data.size() - offset, left.data(), count, nullptr);
+        offset += decodeChannel(data.data() + offset, data.size() - offset, right.data(), count, left.data());
+        samples.append(left.data(), right.data(), count);
+    }
+
+    return samples;
+}
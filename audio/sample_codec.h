@@ -0,0 +1,27 @@
+#ifndef SAMPLE_CODEC_H
+#define SAMPLE_CODEC_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "sample_store.h"
+
+/*
+ * Lossless compression of samples, chunk by chunk and channel by channel:
+ * Silent chunks take no space, chunks of 16-bit origin are delta and Rice coded,
+ * other float chunks are XORed with the previous sample then packed to their significant bits.
+ * Decoded samples are bit for bit identical to the encoded ones.
+ */
+class SampleCodec {
+        // SAME: The right channel is a copy of the left one (eg: mono).
+        enum Mode : uint8_t { SILENCE, PCM16, XOR, RAW, SAME };
+
+        static void encodeChannel(const float* samples, size_t count, std::vector<uint8_t>& out);
+        static size_t decodeChannel(const uint8_t* data, size_t size, float* samples, size_t count, const float* left);
+
+    public:
+        static std::vector<uint8_t> encode(const SampleStore& samples);
+        static SampleStore decode(const std::vector<uint8_t>& data);
+};
+
+#endif // SAMPLE_CODEC_H
@@ -0,0 +1,553 @@
+#include "sample_store.h"
+#include "worker_pool.h"
+#include "wav_map.h"
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+/*
+ * Returns a pseudo-random node priority (xorshift). Each thread has its own sequence.
+ */
+uint32_t randomPriority()
+{
+    static thread_local uint32_t state = 2463534242u;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+
+    return state;
+}
+
+}
+
+SampleStore::Tree SampleStore::makeNode(Piece piece, uint32_t priority)
+{
+    size_t length = piece.length;
+
+    return Tree(new Node{std::move(piece), length, priority, nullptr, nullptr});
+}
+
+/*
+ * Recomputes the number of frames of a subtree after its children have changed.
+ */
+void SampleStore::update(Node* node)
+{
+    node->length = lengthOf(node->left) + node->piece.length + lengthOf(node->right);
+}
+
+/*
+ * Splits the tree into the pieces before the given position and the ones after it.
+ * A piece across the position is split in two, both halves referring to the same block (or file).
+ */
+void SampleStore::split(Tree tree, size_t position, Tree& left, Tree& right)
+{
+    if (!tree) {
+        left.reset();
+        right.reset();
+        return;
+    }
+
+    size_t pieceStart = lengthOf(tree->left);
+    size_t pieceEnd = pieceStart + tree->piece.length;
+
+    if (position <= pieceStart) {
+        split(std::move(tree->left), position, left, tree->left);
+        update(tree.get());
+        right = std::move(tree);
+    }
+    else if (position >= pieceEnd) {
+        split(std::move(tree->right), position - pieceEnd, tree->right, right);
+        update(tree.get());
+        left = std::move(tree);
+    }
+    else {
+        size_t offset = position - pieceStart;
+        Piece second = tree->piece;
+        second.offset += offset;
+        second.length -= offset;
+        tree->piece.length = offset;
+
+        // The second half takes over the right subtree, so it keeps the priority of the node.
+        Tree node = makeNode(std::move(second), tree->priority);
+        node->right = std::move(tree->right);
+        update(node.get());
+        update(tree.get());
+        left = std::move(tree);
+        right = std::move(node);
+    }
+}
+
+/*
+ * Joins two trees, the pieces of the left one coming first.
+ */
+SampleStore::Tree SampleStore::merge(Tree left, Tree right)
+{
+    if (!left) {
+        return right;
+    }
+
+    if (!right) {
+        return left;
+    }
+
+    if (left->priority > right->priority) {
+        left->right = merge(std::move(left->right), std::move(right));
+        update(left.get());
+
+        return left;
+    }
+
+    right->left = merge(std::move(left), std::move(right->left));
+    update(right.get());
+
+    return right;
+}
+
+/*
+ * Duplicates a tree. The pieces share their blocks with the original ones.
+ */
+SampleStore::Tree SampleStore::copy(const Node* node)
+{
+    if (!node) {
+        return nullptr;
+    }
+
+    Tree result = makeNode(node->piece, node->priority);
+    result->length = node->length;
+    result->left = copy(node->left.get());
+    result->right = copy(node->right.get());
+
+    return result;
+}
+
+/*
+ * Calls the function on each piece overlapping the given range of frames, in order,
+ * along with the position of the piece. Only the subtrees overlapping the range are
+ * walked through (ie: O(log pieces) plus the pieces visited).
+ */
+template <typename NodePointer, typename Function>
+void SampleStore::visit(NodePointer node, size_t nodeStart, size_t start, size_t end, Function& function)
+{
+    if (!node) {
+        return;
+    }
+
+    size_t pieceStart = nodeStart + lengthOf(node->left);
+    size_t pieceEnd = pieceStart + node->piece.length;
+
+    if (start < pieceStart) {
+        visit(static_cast<NodePointer>(node->left.get()), nodeStart, start, end, function);
+    }
+
+    if (start < pieceEnd && end > pieceStart) {
+        function(node->piece, pieceStart);
+    }
+
+    if (end > pieceEnd) {
+        visit(static_cast<NodePointer>(node->right.get()), pieceEnd, start, end, function);
+    }
+}
+
+SampleStore::Node* SampleStore::getLastNode() const
+{
+    Node* node = root.get();
+
+    while (node && node->right) {
+        node = node->right.get();
+    }
+
+    return node;
+}
+
+void SampleStore::appendPiece(Piece piece)
+{
+    root = merge(std::move(root), makeNode(std::move(piece), randomPriority()));
+}
+
+/*
+ * Copies the slice of a block shared with other pieces (or of a file), so that it can be modified.
+ * The new block is sized to the piece.
+ */
+void SampleStore::makeWritable(Piece& piece)
+{
+    if (piece.file) {
+        auto block = std::make_shared<Block>(piece.length);
+        piece.file->read(piece.offset, piece.length, block->left, block->right);
+        piece.file.reset();
+        piece.block = std::move(block);
+        piece.offset = 0;
+        return;
+    }
+
+    if (piece.block.use_count() == 1) {
+        return;
+    }
+
+    auto block = std::make_shared<Block>(piece.length);
+    std::memcpy(block->left, piece.block->left + piece.offset, piece.length * sizeof(float));
+    std::memcpy(block->right, piece.block->right + piece.offset, piece.length * sizeof(float));
+    piece.block = std::move(block);
+    piece.offset = 0;
+}
+
+SampleStore& SampleStore::operator=(const SampleStore& other)
+{
+    if (this != &other) {
+        root = copy(other.root.get());
+    }
+
+    return *this;
+}
+
+void SampleStore::clear()
+{
+    root.reset();
+}
+
+/*
+ * Drops the frames beyond the given count or appends silent frames up to it.
+ */
+void SampleStore::resize(size_t count)
+{
+    size_t frameCount = size();
+
+    if (count < frameCount) {
+        erase(count, frameCount);
+    }
+    else if (count > frameCount) {
+        append(nullptr, nullptr, count - frameCount);
+    }
+}
+
+/*
+ * Adds the given frames at the end of the samples (silent frames if left and right are null).
+ */
+void SampleStore::append(const float* left, const float* right, size_t count)
+{
+    while (count > 0) {
+        // Fill up the last block first if no other piece refers to it.
+        Node* last = getLastNode();
+        bool lastBlockFree = last != nullptr && last->piece.block.use_count() == 1 &&
+                             last->piece.offset + last->piece.length < last->piece.block->capacity;
+
+        if (!lastBlockFree) {
+            appendPiece({std::make_shared<Block>(), 0, 0, nullptr});
+            last = getLastNode();
+        }
+
+        Piece& piece = last->piece;
+        size_t end = piece.offset + piece.length;
+        size_t n = std::min(count, piece.block->capacity - end);
+
+        if (left != nullptr && right != nullptr) {
+            std::memcpy(piece.block->left + end, left, n * sizeof(float));
+            std::memcpy(piece.block->right + end, right, n * sizeof(float));
+            left += n;
+            right += n;
+        }
+        else {
+            std::fill_n(piece.block->left + end, n, 0.0f);
+            std::fill_n(piece.block->right + end, n, 0.0f);
+        }
+
+        // The last piece is in the subtree of every node on the right edge of the tree.
+        for (Node* node = root.get(); node != nullptr; node = node->right.get()) {
+            node->length += n;
+        }
+
+        piece.length += n;
+        count -= n;
+    }
+}
+
+/*
+ * Adds the first frames of the given block at the end of the samples without copying them.
+ */
+void SampleStore::appendBlock(std::shared_ptr<Block> block, size_t length)
+{
+    length = std::min(length, block->capacity);
+
+    if (length == 0) {
+        return;
+    }
+
+    appendPiece({std::move(block), 0, length, nullptr});
+}
+
+/*
+ * Adds the given range of frames of a memory mapped file at the end of the samples.
+ * The frames are read from the file as needed instead of being loaded into memory.
+ */
+void SampleStore::appendFile(std::shared_ptr<const WavMap> file, size_t start, size_t count)
+{
+    // A piece fits in a block in case it has to be copied.
+    for (size_t done = 0; done < count; done += SAMPLE_BLOCK_SIZE) {
+        appendPiece({nullptr, start + done, std::min<size_t>(count - done, SAMPLE_BLOCK_SIZE), file});
+    }
+}
+
+/*
+ * Copies the given range of frames into the left and right buffers (either of them can be null).
+ * Returns the number of frames copied.
+ */
+size_t SampleStore::read(size_t start, size_t count, float* left, float* right) const
+{
+    size_t frameCount = size();
+
+    if (start >= frameCount) {
+        return 0;
+    }
+
+    count = std::min(count, frameCount - start);
+    size_t copied = 0;
+
+    auto copyPiece = [&](const Piece& piece, size_t pieceStart) {
+        size_t offset = start + copied - pieceStart;
+        size_t n = std::min(piece.length - offset, count - copied);
+
+        if (piece.file) {
+            piece.file->read(piece.offset + offset, n, left ? left + copied : nullptr, right ? right + copied : nullptr);
+            copied += n;
+            return;
+        }
+
+        if (left != nullptr) {
+            std::memcpy(left + copied, piece.block->left + piece.offset + offset, n * sizeof(float));
+        }
+
+        if (right != nullptr) {
+            std::memcpy(right + copied, piece.block->right + piece.offset + offset, n * sizeof(float));
+        }
+
+        copied += n;
+    };
+
+    visit(static_cast<const Node*>(root.get()), 0, start, start + count, copyPiece);
+
+    return count;
+}
+
+/*
+ * Overwrites the given range of frames with the left and right buffers.
+ */
+void SampleStore::write(size_t start, size_t count, const float* left, const float* right)
+{
+    modify(start, count, [=](size_t position, float* l, float* r, size_t n) {
+        std::memcpy(l, left + (position - start), n * sizeof(float));
+        std::memcpy(r, right + (position - start), n * sizeof(float));
+    });
+}
+
+/*
+ * Calls the modifier on each contiguous part of the given range of frames.
+ * Note: As long as the blocks aren't shared, the pieces are left as is, so that
+ *       several threads can modify distinct ranges at the same time (ie: decoding).
+ */
+void SampleStore::modify(size_t start, size_t count, const Modifier& modifier)
+{
+    size_t frameCount = size();
+
+    if (start >= frameCount) {
+        return;
+    }
+
+    count = std::min(count, frameCount - start);
+    size_t done = 0;
+
+    auto apply = [&](Piece& piece, size_t pieceStart) {
+        makeWritable(piece);
+        size_t offset = start + done - pieceStart;
+        size_t n = std::min(piece.length - offset, count - done);
+
+        modifier(start + done, piece.block->left + piece.offset + offset, piece.block->right + piece.offset + offset, n);
+        done += n;
+    };
+
+    visit(root.get(), 0, start, start + count, apply);
+}
+
+/*
+ * Calls the modifier on each contiguous part of the given range of frames, channel by channel.
+ * Long ranges are shared out between the threads of the worker pool, so the modifier
+ * must only depend on the position of the samples (not on the order of the calls).
+ */
+void SampleStore::process(size_t start, size_t count, const ChannelModifier& modifier)
+{
+    size_t frameCount = size();
+
+    if (start >= frameCount) {
+        return;
+    }
+
+    count = std::min(count, frameCount - start);
+
+    struct Part {
+        size_t position;
+        float* left;
+        float* right;
+        size_t count;
+    };
+
+    // First, make all the blocks writable as copying them changes the pieces.
+    std::vector<Part> parts;
+    size_t done = 0;
+
+    auto collect = [&](Piece& piece, size_t pieceStart) {
+        makeWritable(piece);
+        size_t offset = start + done - pieceStart;
+        size_t n = std::min(piece.length - offset, count - done);
+
+        parts.push_back({start + done, piece.block->left + piece.offset + offset, piece.block->right + piece.offset + offset, n});
+        done += n;
+    };
+
+    visit(root.get(), 0, start, start + count, collect);
+
+    // One task per part and channel.
+    auto task = [&](size_t index) {
+        const Part& part = parts[index / 2];
+        modifier(part.position, index % 2 == 0 ? part.left : part.right, part.count);
+    };
+
+    if (count < PARALLEL_EDIT_MIN_SIZE) {
+        for (size_t i = 0; i < parts.size() * 2; i++) {
+            task(i);
+        }
+
+        return;
+    }
+
+    WorkerPool::getInstance().parallelFor(parts.size() * 2, task);
+}
+
+/*
+ * Returns the given range of frames as a new store sharing the blocks of this one.
+ */
+SampleStore SampleStore::slice(size_t start, size_t end) const
+{
+    SampleStore result;
+    end = std::min(end, size());
+
+    if (start >= end) {
+        return result;
+    }
+
+    auto add = [&](const Piece& piece, size_t pieceStart) {
+        Piece part = piece;
+        size_t from = std::max(start, pieceStart) - pieceStart;
+        size_t to = std::min(end, pieceStart + piece.length) - pieceStart;
+        part.offset += from;
+        part.length = to - from;
+        result.appendPiece(std::move(part));
+    };
+
+    visit(static_cast<const Node*>(root.get()), 0, start, end, add);
+
+    return result;
+}
+
+/*
+ * Removes the given range of frames. Blocks no longer referred to are freed.
+ */
+void SampleStore::erase(size_t start, size_t end)
+{
+    end = std::min(end, size());
+
+    if (start >= end) {
+        return;
+    }
+
+    Tree before, rest, removed, after;
+    split(std::move(root), start, before, rest);
+    split(std::move(rest), end - start, removed, after);
+    root = merge(std::move(before), std::move(after));
+}
+
+/*
+ * Inserts the frames of another store at the given position, sharing its blocks.
+ */
+void SampleStore::insert(size_t position, const SampleStore& other)
+{
+    if (other.empty()) {
+        return;
+    }
+
+    Tree before, after;
+    split(std::move(root), std::min(position, size()), before, after);
+    root = merge(merge(std::move(before), copy(other.root.get())), std::move(after));
+}
+
+/*
+ * Replaces the given range of frames with the frames of another store, sharing its blocks.
+ */
+void SampleStore::replace(size_t start, size_t end, const SampleStore& other)
+{
+    erase(start, end);
+    insert(start, other);
+}
+
+/*
+ * Returns the memory (in bytes) taken by the blocks this store is the only one to refer to,
+ * ie: the memory that would be freed along with the store (the file pieces take none).
+ */
+size_t SampleStore::getMemoryUsage() const
+{
+    // Count the references to each block made from this store.
+    std::unordered_map<const Block*, long> references;
+    std::vector<const Piece*> pieces;
+
+    auto count = [&](const Piece& piece, size_t) {
+        if (piece.block) {
+            references[piece.block.get()]++;
+            pieces.push_back(&piece);
+        }
+    };
+
+    visit(static_cast<const Node*>(root.get()), 0, 0, size(), count);
+    size_t usage = 0;
+
+    for (const Piece* piece : pieces) {
+        auto it = references.find(piece->block.get());
+
+        // Count each block once.
+        if (it != references.end()) {
+            if (piece->block.use_count() == it->second) {
+                usage += piece->block->capacity * 2 * sizeof(float);
+            }
+
+            references.erase(it);
+        }
+    }
+
+    return usage;
+}
+
+/*
+ * Checks whether some of the blocks are also referred to from outside of this store
+ * (eg: by the track samples).
+ */
+bool SampleStore::isShared() const
+{
+    // Count the references to each block made from this store.
+    std::unordered_map<const Block*, long> references;
+    std::vector<const Piece*> pieces;
+
+    auto count = [&](const Piece& piece, size_t) {
+        if (piece.block) {
+            references[piece.block.get()]++;
+            pieces.push_back(&piece);
+        }
+    };
+
+    visit(static_cast<const Node*>(root.get()), 0, 0, size(), count);
+
+    for (const Piece* piece : pieces) {
+        if (piece->block.use_count() > references[piece->block.get()]) {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,114 @@
+#ifndef SAMPLE_STORE_H
+#define SAMPLE_STORE_H
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include "../constants.h"
+
+// Forward declaration.
+class WavMap;
+
+/*
+ * Holds the stereo samples of a track as a piece table: A sequence of pieces, each one
+ * referring to a slice of a reference-counted block of samples.
+ * Inserting or deleting samples only splits, drops or moves pieces around, so no sample
+ * is copied. The pieces are kept in a treap (ie: a binary tree balanced by random priorities)
+ * where each node holds the number of frames of its subtree, so that finding a frame,
+ * splitting the pieces at a position or joining two sequences of pieces cost O(log pieces).
+ * Blocks can be shared between pieces (and stores), in which case they're copied
+ * before being written (ie: copy-on-write).
+ * Pieces can also refer to the frames of a memory mapped file (eg: a take recorded to disk),
+ * in which case they're copied into a block the first time they're written.
+ * The store isn't thread safe: It's only modified from the GUI thread while the audio
+ * thread doesn't read it (ie: the track is stopped), the decoders excepted (see modify).
+ */
+class SampleStore {
+    public:
+        struct Block {
+            // The number of frames the block can hold.
+            const size_t capacity;
+            float* const left;
+            float* const right;
+
+            // Note: The samples are left uninitialized.
+            explicit Block(size_t frames = SAMPLE_BLOCK_SIZE)
+                : capacity(frames), left(new float[frames * 2]), right(left + frames) {}
+            ~Block() { delete[] left; }
+            Block(const Block&) = delete;
+            Block& operator=(const Block&) = delete;
+        };
+
+        // Gives write access to a contiguous part of the samples starting at the given position.
+        using Modifier = std::function<void(size_t position, float* left, float* right, size_t count)>;
+        // Same as above for one channel at a time.
+        using ChannelModifier = std::function<void(size_t position, float* samples, size_t count)>;
+
+    private:
+        struct Piece {
+            std::shared_ptr<Block> block;
+            // The offset is in the block, or in the file if any.
+            size_t offset;
+            size_t length;
+            std::shared_ptr<const WavMap> file;
+        };
+
+        // The pieces are in order of position: The position of a piece is the number
+        // of frames of the pieces on its left.
+        struct Node {
+            Piece piece;
+            // The frames of the subtree.
+            size_t length;
+            // Higher than the ones of the children.
+            uint32_t priority;
+            std::unique_ptr<Node> left;
+            std::unique_ptr<Node> right;
+        };
+
+        using Tree = std::unique_ptr<Node>;
+
+        Tree root;
+
+        static Tree makeNode(Piece piece, uint32_t priority);
+        static size_t lengthOf(const Tree& tree) { return tree ? tree->length : 0; }
+        static void update(Node* node);
+        static void split(Tree tree, size_t position, Tree& left, Tree& right);
+        static Tree merge(Tree left, Tree right);
+        static Tree copy(const Node* node);
+        template <typename NodePointer, typename Function>
+        static void visit(NodePointer node, size_t nodeStart, size_t start, size_t end, Function& function);
+        Node* getLastNode() const;
+        void appendPiece(Piece piece);
+        void makeWritable(Piece& piece);
+
+    public:
+        SampleStore() = default;
+        SampleStore(const SampleStore& other) : root(copy(other.root.get())) {}
+        SampleStore& operator=(const SampleStore& other);
+        SampleStore(SampleStore&&) = default;
+        SampleStore& operator=(SampleStore&&) = default;
+
+        void clear();
+        void resize(size_t count);
+        void append(const float* left, const float* right, size_t count);
+        void appendBlock(std::shared_ptr<Block> block, size_t length);
+        void appendFile(std::shared_ptr<const WavMap> file, size_t start, size_t count);
+        size_t read(size_t start, size_t count, float* left, float* right) const;
+        void write(size_t start, size_t count, const float* left, const float* right);
+        void modify(size_t start, size_t count, const Modifier& modifier);
+        void process(size_t start, size_t count, const ChannelModifier& modifier);
+        SampleStore slice(size_t start, size_t end) const;
+        void erase(size_t start, size_t end);
+        void insert(size_t position, const SampleStore& other);
+        void replace(size_t start, size_t end, const SampleStore& other);
+
+        // Getters.
+        size_t size() const { return lengthOf(root); }
+        bool empty() const { return size() == 0; }
+        size_t getMemoryUsage() const;
+        bool isShared() const;
+};
+
+#endif // SAMPLE_STORE_H
@@ -0,0 +1,161 @@
+#include "spill_file.h"
+#include <iterator>
+#include <iostream>
+#include <stdexcept>
+#include <unistd.h>
+
+SpillFile::~SpillFile()
+{
+    // The temporary file is deleted on closing.
+    if (file) {
+        std::fclose(file);
+    }
+}
+
+/*
+ * Returns the offset of an area of the given size, taken from the free areas
+ * if possible, from the end of the file otherwise.
+ */
+size_t SpillFile::allocate(size_t size)
+{
+    for (auto it = freeAreas.begin(); it != freeAreas.end(); ++it) {
+        if (it->second >= size) {
+            size_t offset = it->first;
+            size_t left = it->second - size;
+            freeAreas.erase(it);
+
+            if (left > 0) {
+                freeAreas[offset + size] = left;
+            }
+
+            return offset;
+        }
+    }
+
+    size_t offset = fileSize;
+    fileSize += size;
+
+    return offset;
+}
+
+/*
+ * Stores the given data in the file and returns where it is.
+ */
+SpillFile::Record SpillFile::write(const std::vector<uint8_t>& data)
+{
+    Record record;
+    record.size = data.size();
+
+    if (record.size == 0) {
+        return record;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // The file is created on the first write.
+    if (file == nullptr) {
+        file = std::tmpfile();
+
+        if (file == nullptr) {
+            throw std::runtime_error("Couldn't create the spill file.");
+        }
+    }
+
+    record.offset = allocate(record.size);
+
+    if (fseeko(file, record.offset, SEEK_SET) != 0 || std::fwrite(data.data(), 1, record.size, file) != record.size) {
+        releaseArea(record);
+        throw std::runtime_error("Couldn't write to the spill file.");
+    }
+
+    return record;
+}
+
+/*
+ * Reads back the data stored at the given record.
+ * NB: The record is still valid until it's released.
+ */
+std::vector<uint8_t> SpillFile::read(const Record& record)
+{
+    std::vector<uint8_t> data(record.size);
+
+    if (record.size == 0) {
+        return data;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (file == nullptr || fseeko(file, record.offset, SEEK_SET) != 0 ||
+        std::fread(data.data(), 1, record.size, file) != record.size) {
+        throw std::runtime_error("Couldn't read from the spill file.");
+    }
+
+    return data;
+}
+
+/*
+ * Makes the area of the given record available for the next writes.
+ */
+void SpillFile::release(const Record& record)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    releaseArea(record);
+}
+
+void SpillFile::releaseArea(const Record& record)
+{
+    size_t size = record.size;
+
+    if (size == 0) {
+        return;
+    }
+
+    size_t offset = record.offset;
+
+    // Merge with the adjacent free areas.
+    auto next = freeAreas.lower_bound(offset);
+
+    if (next != freeAreas.end() && next->first == offset + size) {
+        size += next->second;
+        next = freeAreas.erase(next);
+    }
+
+    if (next != freeAreas.begin()) {
+        auto previous = std::prev(next);
+
+        if (previous->first + previous->second == offset) {
+            offset = previous->first;
+            size += previous->second;
+            freeAreas.erase(previous);
+        }
+    }
+
+    // The area is at the end of the file, which can just be shortened.
+    if (offset + size == fileSize) {
+        fileSize = offset;
+
+        if (file && ftruncate(fileno(file), fileSize) != 0) {
+            // Not a problem, the space will be reused anyway.
+            std::cerr << "Couldn't truncate the spill file." << std::endl;
+        }
+
+        return;
+    }
+
+    freeAreas[offset] = size;
+}
+
+/*
+ * Returns the size (in bytes) of the data currently stored in the file.
+ */
+size_t SpillFile::getUsedSize() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t freeSize = 0;
+
+    for (const auto& area : freeAreas) {
+        freeSize += area.second;
+    }
+
+    return fileSize - freeSize;
+}
@@ -0,0 +1,52 @@
+#ifndef SPILL_FILE_H
+#define SPILL_FILE_H
+
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+#include <mutex>
+
+/*
+ * Temporary file in which data is moved out of memory (eg: the compressed backups of
+ * old edit commands), then read back when needed. The file is deleted as soon as it's closed and
+ * the space of the data released is reused for the next one.
+ * The file can be used from several threads (eg: written by the history compressor
+ * while the GUI thread reads it).
+ */
+class SpillFile {
+    public:
+        // Where a piece of data is stored in the file.
+        struct Record {
+            size_t offset = 0;
+            size_t size = 0;
+        };
+
+    private:
+        FILE* file = nullptr;
+        size_t fileSize = 0;
+        // Free areas of the file (offset => size in bytes).
+        std::map<size_t, size_t> freeAreas;
+        mutable std::mutex mutex;
+
+        size_t allocate(size_t size);
+        void releaseArea(const Record& record);
+
+    public:
+        SpillFile() = default;
+        ~SpillFile();
+        // Not copyable (owns the file).
+        SpillFile(const SpillFile&) = delete;
+        SpillFile& operator=(const SpillFile&) = delete;
+
+        Record write(const std::vector<uint8_t>& data);
+        std::vector<uint8_t> read(const Record& record);
+        void release(const Record& record);
+
+        // Getters.
+        size_t getSize() const { return fileSize; }
+        size_t getUsedSize() const;
+};
+
+#endif // SPILL_FILE_H
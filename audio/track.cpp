@@ -3,6 +3,27 @@
 #include "../../libraries/miniaudio.h"
 
 
+Track::Track(Engine& e) : engine(e)
+{
+    // Note: The semaphore lives as long as the track since the audio thread may post it
+    //       right after the recording is stopped.
+    sem_init(&captureSignal, 0, 0);
+    // The removed edits are deleted once the audio callbacks can no longer read them.
+    editList.setReaderBarrier([this]() { engine.waitForCallbacks(); });
+}
+
+Track::~Track()
+{
+    // Make sure the loader thread is no longer writing into the buffers.
+    cancelLoading();
+
+    if (loaderThread.joinable()) {
+        loaderThread.join();
+    }
+
+    sem_destroy(&captureSignal);
+}
+
 void Track::setId(unsigned int i)
 {
     // Make sure ID is initialized only once.
@@ -14,13 +35,64 @@ void Track::setId(unsigned int i)
     id = i;
 }
 
+/*
+ * Adds a block of samples to the output, bringing the channel gains closer to the target ones
+ * with a linear ramp over the block so that gain changes don't cause clicks (ie: zipper noise).
+ */
+void Track::mixBlock(float* output, float* left, float* right, size_t count, float targetLeft, float targetRight)
+{
+    if (leftGain == targetLeft && rightGain == targetRight) {
+        Kernels::mixStereo(output, left, right, count, leftGain, rightGain);
+        return;
+    }
+
+    // Go over part of the remaining gap at each block.
+    float progress = std::min(1.0f, static_cast<float>(count) / GAIN_SMOOTHING_FRAMES);
+    float nextLeft = leftGain + (targetLeft - leftGain) * progress;
+    float nextRight = rightGain + (targetRight - rightGain) * progress;
+
+    // Close enough: Land on the target gains.
+    if (std::fabs(targetLeft - nextLeft) < 1e-4f && std::fabs(targetRight - nextRight) < 1e-4f) {
+        nextLeft = targetLeft;
+        nextRight = targetRight;
+    }
+
+    Kernels::gainRamp(left, count, 0, leftGain, (nextLeft - leftGain) / count);
+    Kernels::gainRamp(right, count, 0, rightGain, (nextRight - rightGain) / count);
+    Kernels::mixStereo(output, left, right, count, 1.0f, 1.0f);
+
+    leftGain = nextLeft;
+    rightGain = nextRight;
+}
+
+/*
+ * Returns the playback range last published by the GUI thread, or the previous one
+ * if it's being written (audio thread). Never waits, so the GUI thread doesn't have to either.
+ */
+const Track::PlaybackRange& Track::readPlaybackRange()
+{
+    unsigned int sequence = playbackRangeSequence.load(std::memory_order_acquire);
+
+    if ((sequence & 1) == 0) {
+        PlaybackRange range = {playbackLoopStart.load(std::memory_order_relaxed), playbackSelectionEnd.load(std::memory_order_relaxed)};
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (playbackRangeSequence.load(std::memory_order_relaxed) == sequence) {
+            playbackRange = range;
+        }
+    }
+
+    return playbackRange;
+}
+
 /*
  * Fills the given output buffer with interleaved stereo samples.
+ * The track is silent while other tracks are soloed (unless it's soloed too).
  */
-void Track::mixInto(float* output, int frameCount) 
+void Track::mixInto(float* output, int frameCount, bool soloActive) 
 {
     // Check first if the track is playing.
-    if (!playing.load()) {
+    if (!playing.load() || stopping.load()) {
         return;
     } 
 
@@ -31,57 +103,127 @@ void Track::mixInto(float* output, int frameCount)
     }
 
     eof.store(false);
+    // The samples can be shorter than the loaded frames (eg: deletions).
+    const size_t endFrame = std::min(totalFrames.load(), getFrameCount());
+    const PlaybackRange& range = readPlaybackRange();
+    const size_t loopStart = static_cast<size_t>(range.loopStart);
+    const uint64_t selectionEnd = range.selectionEnd;
+    const bool looped = getApplication().isLooped();
+    // Playback goes up to the end of the selection (if any) or of the file.
+    const size_t stopFrame = selectionEnd != NO_SELECTION_END ? std::min(endFrame, static_cast<size_t>(selectionEnd)) : endFrame;
+    const uint64_t startPosition = playbackSampleIndex.load(std::memory_order_relaxed);
+    size_t position = static_cast<size_t>(startPosition);
+    const size_t total = static_cast<size_t>(std::max(frameCount, 0));
+    size_t mixed = 0;
+    bool wrapped = false;
+    float left[MIX_BLOCK_SIZE], right[MIX_BLOCK_SIZE];
+
+    // The channel gains to reach. Balance pan law: The center leaves both channels at the track gain.
+    float targetLeft = 0.0f, targetRight = 0.0f;
+
+    if (!muted.load(std::memory_order_relaxed) && (!soloActive || soloed.load(std::memory_order_relaxed))) {
+        float trackGain = gain.load(std::memory_order_relaxed);
+        float trackPan = pan.load(std::memory_order_relaxed);
+        targetLeft = trackGain * std::min(1.0f, 1.0f - trackPan);
+        targetRight = trackGain * std::min(1.0f, 1.0f + trackPan);
+    }
 
-    // Fill buffer.
-    for (int i = 0; i < frameCount; ++i) {
-        // Increment the sample index (ie: ++).
-        int idx = playbackSampleIndex.fetch_add(1, std::memory_order_relaxed);
+    // Playback (re)starts at the current settings, on a whole frame.
+    if (resetGains.exchange(false)) {
+        leftGain = targetLeft;
+        rightGain = targetRight;
+        playbackFraction = 0;
+    }
 
-        // End of audio file.
-        if (idx >= totalFrames) {
-            if (getApplication().isLooped()) {
-                // Go back to the cursor's current position.
-                playbackSampleIndex.store(getWaveform().getCursorSamplePosition(), std::memory_order_relaxed);
+    const Resampler::SourceReader source = [this](size_t start, size_t count, float* l, float* r) {
+        return readFrames(start, count, l, r);
+    };
+
+    // Fill buffer block by block.
+    while (mixed < total) {
+        if (position >= stopFrame) {
+            // Go back to the start of the selection (or the cursor's position) and carry on
+            // filling the buffer.
+            if (looped && loopStart < stopFrame) {
+                position = loopStart;
+                playbackFraction = 0;
+                wrapped = true;
+                continue;
             }
-            else {
+
+            // Let the GUI thread stop playback.
+            if (stopFrame == endFrame) {
                 eof.store(true);
-                // Stop playback.
-                getApplication().onStop(*this);
+                sendPlaybackEvent(Engine::TrackEvent::Type::END_OF_FILE);
+            }
+            else {
+                sendPlaybackEvent(Engine::TrackEvent::Type::END_OF_SELECTION);
             }
 
-            // Exit the loop and function.
             break;
         }
 
-        // Playback has reached the end of the current selection.
-        if (getWaveform().selection() && idx >= getWaveform().getSelectionEndSample()) {
-            if (getApplication().isLooped()) {
-                // Go back to the start of the selection.
-                playbackSampleIndex.store(getWaveform().getSelectionStartSample(), std::memory_order_relaxed);
+        // --- Copy audio data to output device. ---
+
+        size_t count = std::min(total - mixed, static_cast<size_t>(MIX_BLOCK_SIZE));
+        bool silent = leftGain == 0.0f && rightGain == 0.0f && targetLeft == 0.0f && targetRight == 0.0f;
+
+        // The file sample rate differs from the output one.
+        // Note: The position moves on at the file rate.
+        if (resampler.isActive()) {
+            count = resampler.process(position, playbackFraction, count, stopFrame, left, right, source);
+
+            if (count == 0) {
+                break;
             }
-            else {
-                // Stop playback.
-                getApplication().onStop(*this);
+
+            if (!silent) {
+                mixBlock(output + mixed * 2, left, right, count, targetLeft, targetRight);
             }
+        }
+        else {
+            count = std::min(count, stopFrame - position);
 
-            // Exit the loop and function.
-            break;
+            // Muted: The position moves on but there's nothing to read.
+            if (!silent) {
+                // The edits (if any) are evaluated once for the whole block.
+                count = readFrames(position, count, left, right);
+
+                if (count == 0) {
+                    break;
+                }
+
+                mixBlock(output + mixed * 2, left, right, count, targetLeft, targetRight);
+            }
+
+            position += count;
         }
 
-        // --- Copy audio data to output device. ---
+        mixed += count;
+    }
+
+    if (wrapped) {
+        sendPlaybackEvent(Engine::TrackEvent::Type::LOOP);
+    }
+
+    // Publish the new position once per callback, unless the GUI thread has moved
+    // the playback position in the meantime (eg: cursor reset).
+    uint64_t expected = startPosition;
 
-        // Left
-        output[i * 2] += leftSamples[idx];   
-        // Right
-        output[i * 2 + 1] += rightSamples[idx];  
+    if (!playbackSampleIndex.compare_exchange_strong(expected, position, std::memory_order_relaxed)) {
+        playbackFraction = 0;
     }
 }
 
-void Track::recordInto(const float* input, ma_uint32 frameCount, ma_uint32 captureChannels)
+/*
+ * Copies the captured frames into the capture ring buffer.
+ * Returns the number of frames dropped because the ring buffer is full (ie: overrun).
+ */
+ma_uint32 Track::recordInto(const float* input, ma_uint32 frameCount, ma_uint32 captureChannels)
 {
     // Check first if the track is recording.
     if (!recording.load()) {
-        return;
+        return 0;
     }
 
     ma_uint32 channels = captureChannels;
@@ -96,14 +238,8 @@ void Track::recordInto(const float* input, ma_uint32 frameCount, ma_uint32 captu
         ma_pcm_rb_acquire_write(&captureRing, &framesToWrite, (void**)&pDst);
 
         // If we can’t write anything right now, stop — ring buffer is full.
+        // The remaining frames are dropped and counted by the engine.
         if (framesToWrite == 0 || pDst == nullptr) {
-            // If buffer full, stop and log once.
-            static std::atomic_flag overrunLogged = ATOMIC_FLAG_INIT;
-
-            if (!overrunLogged.test_and_set()) {
-                std::cerr << "[Overrun] Ring buffer full; dropped " << framesRemaining << "\n";
-            }
-
             break;
         }
 
@@ -122,6 +258,20 @@ void Track::recordInto(const float* input, ma_uint32 frameCount, ma_uint32 captu
             break;
         }
     }
+
+    // Wake the worker up once enough frames are waiting, unless it's already been woken up.
+    // NB: sem_post never blocks.
+    pendingCaptureFrames += frameCount - framesRemaining;
+
+    if (pendingCaptureFrames >= captureWakeupFrames || framesRemaining > 0) {
+        pendingCaptureFrames = 0;
+
+        if (!captureSignaled.exchange(true, std::memory_order_acq_rel)) {
+            sem_post(&captureSignal);
+        }
+    }
+
+    return framesRemaining;
 }
 
 void Track::prepareRecording()
@@ -152,23 +302,92 @@ void Track::prepareRecording()
     // Set the start of the recording to the actual position of the cursor.
     // ie: zero for the very first recording or wherever the cursor is 
     // positioned for the next recordings.
-    captureWriteIndex.store(playbackSampleIndex.load());
+    captureStart = std::min<size_t>(playbackSampleIndex.load(), samples.size());
+    captureWriteIndex.store(captureStart);
+    // The first seconds of the take don't have to allocate anything.
+    capture.clear();
+    capture.reserve(static_cast<size_t>(capacityFrames));
+    capturing.store(true, std::memory_order_release);
     // Clear count.
     totalRecordedFrames.store(0, std::memory_order_release);
+
+    // The worker is woken up every time this amount of frames has been captured.
+    captureWakeupFrames = std::max<ma_uint32>(static_cast<ma_uint32>(static_cast<uint64_t>(captureWakeup) * getSampleRate() / 1000), 1);
+    pendingCaptureFrames = 0;
+    captureSignaled.store(false);
+
+    // Drop the wake ups left from the previous recording.
+    while (sem_trywait(&captureSignal) == 0) {}
+}
+
+void Track::play()
+{
+    stopping.store(false);
+    resetGains.store(true);
+    playing.store(true);
 }
 
-void Track::play() { playing.store(true); }
+/*
+ * Passes the positions the audio callback needs from the waveform (ie: loop start,
+ * selection end). Called from the GUI thread before and during playback.
+ */
+void Track::updatePlaybackRange()
+{
+    auto& waveform = getWaveform();
+    uint64_t start = waveform.getCursorSamplePosition();
+    uint64_t end = NO_SELECTION_END;
+
+    if (waveform.selection()) {
+        start = waveform.getSelectionStartSample();
+        end = waveform.getSelectionEndSample();
+    }
+
+    // Nothing to publish (eg: the selection hasn't changed).
+    if (playbackLoopStart.load(std::memory_order_relaxed) == start && playbackSelectionEnd.load(std::memory_order_relaxed) == end) {
+        return;
+    }
+
+    // Called every frame while playing, so it never waits for the audio callbacks:
+    // The sequence is odd while the range is written.
+    unsigned int sequence = playbackRangeSequence.load(std::memory_order_relaxed);
+    playbackRangeSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    playbackLoopStart.store(start, std::memory_order_relaxed);
+    playbackSelectionEnd.store(end, std::memory_order_relaxed);
+    playbackRangeSequence.store(sequence + 2, std::memory_order_release);
+}
+
+/*
+ * Sends a playback event to the GUI thread (audio thread).
+ */
+void Track::sendPlaybackEvent(Engine::TrackEvent::Type type)
+{
+    bool sent = engine.pushTrackEvent({type, id});
+
+    // Stop mixing until the GUI thread actually stops the track.
+    // NB: If the queue is full, the event is sent again with the next callback.
+    if (sent && type != Engine::TrackEvent::Type::LOOP) {
+        stopping.store(true);
+    }
+}
 void Track::pause() { paused.store(true); }
 void Track::unpause() { paused.store(false); }
 
 void Track::stop()
 {
     playing.store(false);
+    stopping.store(false);
+    bool wasRecording = recording.exchange(false);
 
-    if (recording.load()) {
+    // From now on, the audio callbacks no longer read the samples nor write
+    // into the capture ring buffer, so both can be modified.
+    engine.waitForCallbacks();
+
+    if (wasRecording) {
         // Stop recording audio.
-        recording.store(false);
         workerRunning.store(false);
+        // Don't let the worker wait for its timeout.
+        sem_post(&captureSignal);
 
         // Join worker thread
         if (workerThread.joinable()) {
@@ -177,9 +396,7 @@ void Track::stop()
 
         // Done using the ring buffer.
         ma_pcm_rb_uninit(&captureRing);
-        // Return possible unused memory (allocated through "reserve") to the system.
-        leftSamples.shrink_to_fit();
-        rightSamples.shrink_to_fit();
+        mergeCapture();
 
         // Stop drawing waveform.
         waveform->stopLiveUpdate();
@@ -189,6 +406,12 @@ void Track::stop()
 void Track::record()
 {
     prepareRecording();
+
+    // Stream the take to disk as well. Recording goes on in memory only if the file can't be created.
+    if (!recordingFilename.empty()) {
+        diskRecorder.open(recordingFilename, getSampleRate(), isStereo() ? 2 : 1);
+    }
+
     // Mark the document as "changed". 
     getApplication().documentHasChanged(id);
     // Start recording audio.
@@ -201,7 +424,11 @@ void Track::record()
     workerThread = std::thread(&Track::workerThreadLoop, this);
 }
 
-void Track::drainAndMergeRingBuffer()
+/*
+ * Moves the frames available in the ring buffer into the take (capture worker).
+ * Returns the number of frames moved.
+ */
+size_t Track::drainAndMergeRingBuffer()
 {
     // Always recording stereo.
     const ma_uint32 numChannels = 2;
@@ -209,7 +436,7 @@ void Track::drainAndMergeRingBuffer()
     // --- Step 1: Check how many frames are available in the PCM ring buffer ---
     ma_uint32 framesToRead = ma_pcm_rb_available_read(&captureRing);
     if (framesToRead == 0) {
-        return;
+        return 0;
     }
 
     float* pSrc = nullptr;
@@ -217,7 +444,7 @@ void Track::drainAndMergeRingBuffer()
 
     if (framesToRead == 0 || pSrc == nullptr) {
         // Nothing valid to read.
-        return;
+        return 0;
     }
 
     // --- Step 2: Prepare a preallocated interleaved buffer ---
@@ -257,64 +484,113 @@ void Track::drainAndMergeRingBuffer()
         newRight = newLeft; 
     }
 
-    // --- Step 5: Merge (Punch-In Aware) ---
+    // --- Step 5: Stream the take to disk (if required) ---
+    diskRecorder.write(isStereo() ? interleaved.data() : newLeft.data(), framesToRead);
+
+    // --- Step 6: Append to the take ---
+    // Note: The take is made of blocks which never move, so the GUI thread
+    //       can read the frames already recorded meanwhile.
     size_t writeIndex = captureWriteIndex.load(std::memory_order_acquire);
-    size_t oldLength  = leftSamples.size();
-    size_t newWriteEnd = writeIndex + framesToRead;
-    const size_t blockSize = engine.getDefaultOutputSampleRate();
-
-    // Reserve new required capacity beforehand to prevent multiple
-    // vector memory allocations causing audio glitches.
-    if (newWriteEnd > leftSamples.capacity()) {
-        size_t newCapacity = ((newWriteEnd / blockSize) + 1) * blockSize;
-        leftSamples.reserve(newCapacity);
-        rightSamples.reserve(newCapacity);
-    }
-
-    // --- Step 6: Merge using direct pointer access (handles partial overlap - faster than push_back loop) ---
-    if (writeIndex < oldLength) {
-        // Compute how many frames fit inside the current buffer.
-        size_t overwriteCount = std::min<size_t>(framesToRead, oldLength - writeIndex);
-
-        // Overwrite the existing region.
-        std::copy_n(newLeft.begin(), overwriteCount, leftSamples.begin() + writeIndex);
-        std::copy_n(newRight.begin(), overwriteCount, rightSamples.begin() + writeIndex);
-
-        // If there are still extra frames beyond oldLength, append them.
-        if (overwriteCount < framesToRead) {
-            size_t appendCount = framesToRead - overwriteCount;
-            leftSamples.insert(leftSamples.end(),
-                               newLeft.begin() + overwriteCount,
-                               newLeft.begin() + overwriteCount + appendCount);
-            rightSamples.insert(rightSamples.end(),
-                                newRight.begin() + overwriteCount,
-                                newRight.begin() + overwriteCount + appendCount);
-        }
-    }
-    else {
-        // Entirely beyond old length → just append.
-        leftSamples.insert(leftSamples.end(), newLeft.begin(), newLeft.end());
-        rightSamples.insert(rightSamples.end(), newRight.begin(), newRight.end());
-    }
+    size_t appended = capture.append(newLeft.data(), newRight.data(), framesToRead);
+    size_t newWriteEnd = writeIndex + appended;
 
     // --- Update write cursor to the end of newly written region ---
     captureWriteIndex.store(newWriteEnd, std::memory_order_release);
 
     // --- Step 7: Update stats and GUI ---
-    totalRecordedFrames.fetch_add(framesToRead, std::memory_order_release);
-    totalFrames = leftSamples.size();
+    totalRecordedFrames.fetch_add(appended, std::memory_order_release);
+    totalFrames = getSourceFrameCount();
 
     // --- Step 8: Update dirty range atomically (for GUI) ---
+    markDirty(writeIndex, newWriteEnd);
+
+    return framesToRead;
+}
+
+/*
+ * Replaces the samples the take was recorded over (punch-in) with the take, or appends it.
+ * The blocks of the take are shared, not copied. A new take streamed to disk is memory
+ * mapped from its file instead. Called once the capture worker is done.
+ */
+void Track::mergeCapture()
+{
+    diskRecorder.finish();
+    // The file can replace the take only if it holds all of it (ie: no write has failed).
+    bool onDisk = diskRecorder.isHealthy() && diskRecorder.getFlushedFrames() == capture.size();
+
+    // A new take recorded to disk is simply read from its file.
+    if (onDisk && samples.empty() && captureStart == 0 && mapFile(diskRecorder.getFilename().c_str())) {
+        capturing.store(false, std::memory_order_release);
+        capture.clear();
+        diskRecorder.close();
+        return;
+    }
+
+    // The start of the take may only be on disk, where it's read from instead of
+    // being loaded back into memory. The released frames were flushed before being
+    // freed, so they're in the file even if a later write has failed.
+    SampleStore take;
+    size_t released = capture.getReleasedFrames();
+
+    if (released > 0) {
+        auto file = std::make_shared<WavMap>();
+
+        if (file->open(diskRecorder.getFilename().c_str()) && file->getFrameCount() >= released) {
+            take.appendFile(file, 0, released);
+        }
+        else {
+            // Fall back on copying the frames (eg: the file can't be mapped).
+            std::vector<float> left(DECODE_CHUNK_SIZE), right(DECODE_CHUNK_SIZE);
+
+            for (size_t start = 0; start < released; start += DECODE_CHUNK_SIZE) {
+                size_t read = diskRecorder.read(start, std::min<size_t>(DECODE_CHUNK_SIZE, released - start), left.data(), right.data());
+                take.append(left.data(), right.data(), read);
+            }
+        }
+    }
+
+    size_t length = capture.size();
+    take.insert(take.size(), capture.takeSampleStore());
+    samples.replace(captureStart, captureStart + length, take);
+    capturing.store(false, std::memory_order_release);
+    diskRecorder.close();
+    totalFrames = samples.size();
+}
+
+/*
+ * Frees the memory taken by the oldest part of a take streamed to disk, so that only
+ * the last seconds stay in memory (the rest being read from the file).
+ * Must be called from the GUI thread while recording.
+ */
+void Track::releaseRecordedFrames()
+{
+    if (!diskRecorder.isOpen()) {
+        return;
+    }
+
+    size_t window = static_cast<size_t>(RECORDING_MEMORY_WINDOW) * getSampleRate();
+    size_t recorded = capture.size();
+
+    if (recorded > window) {
+        capture.release(std::min(recorded - window, diskRecorder.getFlushedFrames()));
+    }
+}
+
+/*
+ * Extends the range of samples the GUI has to pull (ie: newly recorded samples).
+ */
+void Track::markDirty(size_t start, size_t end)
+{
     size_t prevStart = dirtyStart.load(std::memory_order_acquire);
     size_t prevEnd   = dirtyEnd.load(std::memory_order_acquire);
 
     // Extend range atomically
-    if (prevStart == SIZE_MAX || writeIndex < prevStart) {
-        dirtyStart.store(writeIndex, std::memory_order_release);
+    if (prevStart == SIZE_MAX || start < prevStart) {
+        dirtyStart.store(start, std::memory_order_release);
     }
 
-    if (newWriteEnd > prevEnd) {
-        dirtyEnd.store(newWriteEnd, std::memory_order_release);
+    if (end > prevEnd) {
+        dirtyEnd.store(end, std::memory_order_release);
     }
 
     newDataAvailable.store(true, std::memory_order_release);
@@ -327,18 +603,30 @@ void Track::workerThreadLoop()
     // setLowPriority();
 
     while (workerRunning.load(std::memory_order_acquire)) {
-        drainAndMergeRingBuffer();
+        // Wait for the audio thread to capture a batch of frames. The timeout bounds the time
+        // the frames can wait (eg: the last frames of a batch when the input stops).
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += static_cast<long>(CAPTURE_WAKEUP_TIMEOUT) * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
 
-        // Sleep 1–2 ms for smooth draining
-        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        while (sem_timedwait(&captureSignal, &deadline) != 0 && errno == EINTR) {}
+
+        captureSignaled.store(false, std::memory_order_release);
+
+        // The available frames may wrap around the end of the ring buffer.
+        while (drainAndMergeRingBuffer() > 0) {}
     }
 
     // One last drain after stop
-    drainAndMergeRingBuffer();
+    while (drainAndMergeRingBuffer() > 0) {}
 }
 
-// Safe method that copies only new data
-bool Track::getNewSamplesCopy(std::vector<float>& leftCopy, std::vector<float>& rightCopy, size_t& newStartIndex, size_t& newCount) {
+/*
+ * Returns the range of samples written since the last call (ie: recorded).
+ */
+bool Track::getNewSamplesRange(size_t& newStartIndex, size_t& newCount) {
     if (!newDataAvailable.load(std::memory_order_acquire)) {
         return false;
     }
@@ -348,17 +636,13 @@ bool Track::getNewSamplesCopy(std::vector<float>& leftCopy, std::vector<float>&
     size_t end   = dirtyEnd.exchange(0, std::memory_order_acq_rel);
     newDataAvailable.store(false, std::memory_order_release);
 
-    if (start == SIZE_MAX || end <= start || end > leftSamples.size()) {
+    if (start == SIZE_MAX || end <= start) {
         return false;
     }
 
     newStartIndex = start;
     newCount = end - start;
 
-    // Copy or overwrite a new chunk of recorded data.
-    leftCopy.assign(leftSamples.begin() + start, leftSamples.begin() + end);
-    rightCopy.assign(rightSamples.begin() + start, rightSamples.begin() + end);
-
     return true;
 }
 
@@ -367,6 +651,31 @@ void Track::setNewTrack(TrackOptions options)
     newTrack = true;
     // Set the track recording format (ie: mono/stereo).
     stereo = options.stereo;
+    // Recorded at the device rate.
+    sampleRate = engine.getDefaultOutputSampleRate();
+    initResampler();
+}
+
+/*
+ * The output sample rate has changed. Called while the devices are stopped.
+ */
+void Track::updateOutputRate()
+{
+    // Nothing recorded yet: Record at the new device rate.
+    if (isNewTrack() && getFrameCount() == 0) {
+        sampleRate = engine.getDefaultOutputSampleRate();
+    }
+
+    initResampler();
+}
+
+/*
+ * Sets the resampler up for the track sample rate (no-op when it matches the output rate).
+ * Must be called before the track is played.
+ */
+void Track::initResampler()
+{
+    resampler.configure(getSampleRate(), engine.getDefaultOutputSampleRate(), resamplerQuality, MIX_BLOCK_SIZE);
 }
 
 /*
@@ -398,101 +707,579 @@ void Track::loadFromFile(const char *filename)
         throw std::runtime_error("Failed to initialized temporary decoder.");
     }
 
-    // Then initialize decoder with format conversion (except for output channels).
-    ma_decoder_config decoderConfig = ma_decoder_config_init(engine.getDefaultOutputFormat(), originalFileFormat.outputChannels, engine.getDefaultOutputSampleRate());
+    // Uncompressed WAV files don't need to be decoded.
+    if (mapFile(filename)) {
+        return;
+    }
+
+    // Then initialize decoder with format conversion (except for output channels and sample rate).
+    // Samples are kept at the file rate and resampled while playing.
+    sampleRate = originalFileFormat.outputSampleRate;
+    initResampler();
+    decoderConfig = ma_decoder_config_init(engine.getDefaultOutputFormat(), originalFileFormat.outputChannels, sampleRate);
 
     if (ma_decoder_init_file(filename, &decoderConfig, &decoder) != MA_SUCCESS) {
         throw std::runtime_error("Failed to initialize decoder with conversion.");
     }
 
-    if (!decodeFile()) {
-        throw std::runtime_error("Failed to decode file.");
+    frameCount = 0;
+
+    if (ma_decoder_get_length_in_pcm_frames(&decoder, &frameCount) != MA_SUCCESS) {
+        ma_decoder_uninit(&decoder);
+        throw std::runtime_error("Failed to get length.");
     }
 
+    // Check whether the file is stereo.
+    // Note: Multichannel files used to be flagged as mono, which then played their
+    //       interleaved samples as one channel. They're now treated as stereo and
+    //       only their first 2 channels are used (see deinterleaveChunk).
+    stereo = decoder.outputChannels >= 2;
+
+    // Allocate the planar buffers for the whole file at once.
+    // Note: Some decoders can't compute the length beforehand (ie: frameCount = 0),
+    //       in which case buffers grow chunk by chunk.
+    samples.clear();
+    samples.resize(static_cast<size_t>(frameCount));
+
     // Reset index.
     playbackSampleIndex.store(0, std::memory_order_relaxed);
+    totalFrames = 0;
+    loadedFrames.store(0);
+    loadCancelled.store(false);
+
+    // Split the file into ranges decoded in parallel. A few ranges per thread
+    // balance the load as some parts of a file decode faster than others.
+    decoderThreads = maxDecoderThreads > 0 ? maxDecoderThreads : std::max(1u, std::thread::hardware_concurrency());
+    decodeRangeCount = static_cast<size_t>(std::clamp<ma_uint64>(frameCount / DECODE_MIN_RANGE_SIZE, 1, decoderThreads * DECODE_RANGES_PER_THREAD));
+    decodeRanges = std::make_unique<DecodeRange[]>(decodeRangeCount);
+
+    for (size_t i = 0; i < decodeRangeCount; i++) {
+        decodeRanges[i].start = frameCount * i / decodeRangeCount;
+        decodeRanges[i].end = frameCount * (i + 1) / decodeRangeCount;
+    }
+
+    // Unknown length: Buffers may be reallocated while decoding,
+    // so the file has to be decoded before anything reads them.
+    if (frameCount == 0) {
+        bool decoded = decodeRange(decoder, decodeRanges[0], true);
+        ma_decoder_uninit(&decoder);
 
-    ma_decoder_uninit(&decoder);
+        if (!decoded) {
+            throw std::runtime_error("Failed to decode file.");
+        }
+
+        finishLoading();
+        return;
+    }
+
+    // Decode the file in background. As the buffers never move while loading,
+    // the part already decoded can be drawn and played meanwhile.
+    loading.store(true);
+    loaderThread = std::thread(&Track::loaderThreadLoop, this);
 }
 
 /*
- * Decode the entire file manually to playback straight from memory (ie: no streaming).
+ * Memory maps uncompressed WAV files, so that samples are converted on demand
+ * instead of being decoded and loaded into memory.
  */
-bool Track::decodeFile()
+bool Track::mapFile(const char* filename)
 {
-    frameCount = 0;
+    std::string extension = std::filesystem::path(filename).extension();
 
-    if (ma_decoder_get_length_in_pcm_frames(&decoder, &frameCount) != MA_SUCCESS) {
-        std::cerr << "Failed to get length" << std::endl;
-        ma_decoder_uninit(&decoder);
+    if (extension != ".wav" && extension != ".WAV") {
         return false;
     }
 
-    // Create a array/buffer to hold the total number of samples (not frames!):
-    // nb frames * nb channels = total nb samples
-    std::vector<float> tempData(static_cast<size_t>(frameCount * decoder.outputChannels));
+    auto map = std::make_shared<WavMap>();
 
-    ma_uint64 framesRead = 0;
-    if (ma_decoder_read_pcm_frames(&decoder, tempData.data(), frameCount, &framesRead) != MA_SUCCESS) {
-        std::cerr << "Failed to read PCM frames" << std::endl;
-        ma_decoder_uninit(&decoder);
+    if (!map->open(filename)) {
         return false;
     }
 
-    // Check whether the file is stereo.
-    stereo = decoder.outputChannels == 2;
-    totalFrames = static_cast<int>(framesRead);
+    // Note: Only the first 2 channels of a multichannel file are used (see decodeFile).
+    stereo = map->getChannels() >= 2;
+    sampleRate = map->getSampleRate();
+    initResampler();
+    samples.clear();
+    wavMap = std::move(map);
+    totalFrames = static_cast<size_t>(wavMap->getFrameCount());
+    playbackSampleIndex.store(0, std::memory_order_relaxed);
+    mapped.store(true, std::memory_order_release);
+
+    return true;
+}
+
+/*
+ * Turns the memory mapped file into samples as they are about to be modified.
+ * The samples still refer to the file, and each part of it is only copied into memory
+ * once it's modified (see SampleStore::appendFile), so this costs nothing whatever the
+ * size of the file. Must be called from the GUI thread.
+ */
+void Track::materialize()
+{
+    if (!isMapped()) {
+        return;
+    }
+
+    samples.clear();
+    samples.appendFile(wavMap, 0, static_cast<size_t>(wavMap->getFrameCount()));
+
+    // Samples are now drawn from the sample store.
+    waveform->updateSamples();
+
+    mapped.store(false, std::memory_order_release);
+}
+
+/*
+ * Copies the given range of frames into the left and right buffers (either of them can be null),
+ * whether the samples are held in memory or memory mapped. Returns the number of frames copied.
+ */
+size_t Track::readSourceFrames(size_t start, size_t count, float* left, float* right) const
+{
+    if (isMapped()) {
+        return static_cast<size_t>(wavMap->read(start, count, left, right));
+    }
+
+    if (!capturing.load(std::memory_order_acquire)) {
+        return samples.read(start, count, left, right);
+    }
+
+    // While recording, the frames of the take hide the samples they're recorded over.
+    const size_t takeEnd = captureStart + capture.size();
+    size_t copied = 0;
+
+    while (copied < count) {
+        size_t position = start + copied;
+        float* l = left ? left + copied : nullptr;
+        float* r = right ? right + copied : nullptr;
+        size_t n = 0;
+
+        if (position < captureStart) {
+            n = samples.read(position, std::min(count - copied, captureStart - position), l, r);
+        }
+        else if (position < captureStart + capture.getReleasedFrames()) {
+            // Only on disk now.
+            n = diskRecorder.read(position - captureStart, std::min(count - copied, captureStart + capture.getReleasedFrames() - position), l, r);
+        }
+        else if (position < takeEnd) {
+            n = capture.read(position - captureStart, std::min(count - copied, takeEnd - position), l, r);
+        }
+        else {
+            n = samples.read(position, count - copied, l, r);
+        }
+
+        if (n == 0) {
+            break;
+        }
+
+        copied += n;
+    }
+
+    return copied;
+}
+
+size_t Track::getSourceFrameCount() const
+{
+    if (isMapped()) {
+        return wavMap->getFrameCount();
+    }
+
+    if (capturing.load(std::memory_order_acquire)) {
+        return std::max(samples.size(), captureStart + capture.size());
+    }
 
-    if (stereo) {
-        // Split into left/right channels
-        leftSamples.clear(); 
-        rightSamples.clear();
+    return samples.size();
+}
+
+/*
+ * Same as above with the non-destructive edits applied.
+ */
+size_t Track::readFrames(size_t start, size_t count, float* left, float* right) const
+{
+    if (editList.empty()) {
+        return readSourceFrames(start, count, left, right);
+    }
+
+    return editList.read(start, count, left, right, [this](size_t from, size_t length, float* l, float* r) {
+        return readSourceFrames(from, length, l, r);
+    });
+}
+
+/*
+ * Writes the non-destructive edits into the samples, which can then be modified in place
+ * (eg: recording). Must be called from the GUI thread while the track isn't playing.
+ */
+void Track::renderEdits()
+{
+    if (editList.empty()) {
+        return;
+    }
+
+    size_t count = getFrameCount();
+    std::vector<float> left(DECODE_CHUNK_SIZE), right(DECODE_CHUNK_SIZE);
+    SampleStore rendered;
+
+    for (size_t start = 0; start < count; start += DECODE_CHUNK_SIZE) {
+        size_t read = readFrames(start, DECODE_CHUNK_SIZE, left.data(), right.data());
+        rendered.append(left.data(), right.data(), read);
+    }
+
+    samples = std::move(rendered);
+    editList.clear();
+    // Note: The mapping is kept as the audio thread may still be reading it.
+    mapped.store(false, std::memory_order_release);
+    totalFrames = samples.size();
 
-        for (int i = 0; i < totalFrames; ++i) {
-            leftSamples.push_back(tempData[i * 2]);
-            rightSamples.push_back(tempData[i * 2 + 1]);
+    waveform->updateSamples();
+}
+
+void Track::loaderThreadLoop()
+{
+    // A single range starts at the beginning of the file, so no need to seek.
+    if (decodeRangeCount == 1) {
+        if (!decodeRange(decoder, decodeRanges[0], true)) {
+            std::cerr << "Failed to decode file: " << originalFileFormat.fileName << std::endl;
         }
+
+        ma_decoder_uninit(&decoder);
     }
-    // Mono data
     else {
-        leftSamples = std::vector<float>(tempData);
-        // Mirror for playback
-        rightSamples = leftSamples;
+        // Each worker seeks through the file with its own decoder.
+        ma_decoder_uninit(&decoder);
+        unsigned int threads = static_cast<unsigned int>(std::min<size_t>(decoderThreads, decodeRangeCount));
+        std::atomic<size_t> nextRange{0};
+        std::vector<std::thread> workers;
+
+        for (unsigned int i = 0; i < threads; i++) {
+            workers.emplace_back(&Track::decoderWorkerLoop, this, std::ref(nextRange));
+        }
+
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    // Let the GUI know decoding is over.
+    loading.store(false, std::memory_order_release);
+}
+
+/*
+ * Decodes the ranges of the file one after another until there's none left.
+ */
+void Track::decoderWorkerLoop(std::atomic<size_t>& nextRange)
+{
+    ma_decoder_config config = decoderConfig;
+    // A seek table makes seeking fast with the formats which support it (ie: mp3).
+    config.seekPointCount = DECODE_SEEK_POINTS;
+    ma_decoder rangeDecoder;
+
+    if (ma_decoder_init_file(originalFileFormat.fileName.c_str(), &config, &rangeDecoder) != MA_SUCCESS) {
+        // The remaining ranges are decoded by the other workers.
+        std::cerr << "Failed to initialize range decoder." << std::endl;
+        return;
+    }
+
+    size_t index;
+
+    while (!loadCancelled.load(std::memory_order_relaxed) && (index = nextRange.fetch_add(1)) < decodeRangeCount) {
+        if (!decodeRange(rangeDecoder, decodeRanges[index], index + 1 == decodeRangeCount)) {
+            std::cerr << "Failed to decode range " << index << " of file: " << originalFileFormat.fileName << std::endl;
+        }
+    }
+
+    ma_decoder_uninit(&rangeDecoder);
+}
+
+/*
+ * Stops decoding. The part already decoded is kept.
+ */
+void Track::cancelLoading()
+{
+    loadCancelled.store(true);
+}
+
+/*
+ * Waits for the loader thread to finish, then fits the buffers to the frames actually decoded
+ * from the start of the file. Must be called from the GUI thread.
+ */
+void Track::finishLoading()
+{
+    if (loaderThread.joinable()) {
+        loaderThread.join();
+    }
+
+    updateDecodedPrefix();
+    size_t decoded = totalFrames.load();
+
+    // The file is shorter than expected or loading has been cancelled.
+    if (decoded < samples.size()) {
+        // Playback (if any) skips a callback while the samples are trimmed.
+        bool wasPlaying = playing.exchange(false);
+        engine.waitForCallbacks();
+        samples.resize(decoded);
+        playing.store(wasPlaying);
+    }
+
+    totalFrames = decoded;
+}
+
+/*
+ * Decodes the given file with a single thread then with one thread per hardware thread
+ * and reports the speedup of the parallel range decoding.
+ */
+void Track::benchmarkDecode(const char* filename)
+{
+    std::string extension = std::filesystem::path(filename).extension();
+
+    // Uncompressed WAV files are memory mapped, not decoded.
+    if (extension == ".wav" || extension == ".WAV") {
+        std::cerr << "WAV files are not decoded, use a compressed file (mp3, flac, ogg)." << std::endl;
+        return;
+    }
+
+    Engine engine(nullptr);
+    unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    double reference = 0.0;
+
+    std::cout << "Decoding of '" << filename << "'" << std::endl;
+    std::cout << std::left << std::setw(10) << "Threads" << std::right << std::setw(10) << "Ranges"
+              << std::setw(12) << "Frames" << std::setw(10) << "ms" << std::setw(10) << "Speedup" << std::endl;
+
+    for (unsigned int threads : {1u, hardwareThreads}) {
+        Track track(engine);
+        track.maxDecoderThreads = threads;
+
+        try {
+            auto start = std::chrono::steady_clock::now();
+            track.loadFromFile(filename);
+
+            while (track.isLoading()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            track.finishLoading();
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+            if (reference == 0.0) {
+                reference = elapsed.count();
+            }
+
+            std::cout << std::left << std::setw(10) << threads << std::right << std::setw(10) << track.decodeRangeCount
+                      << std::setw(12) << track.totalFrames.load() << std::fixed << std::setprecision(1)
+                      << std::setw(10) << elapsed.count() << std::setw(10) << reference / elapsed.count() << std::endl;
+        }
+        catch (const std::runtime_error& error) {
+            std::cerr << "Decoding failed: " << error.what() << std::endl;
+            return;
+        }
+
+        // The same run would be measured twice.
+        if (hardwareThreads == 1) {
+            std::cout << "Only one hardware thread available." << std::endl;
+            break;
+        }
+    }
+}
+
+float Track::getLoadingProgress() const
+{
+    if (frameCount == 0) {
+        return 1.0f;
+    }
+
+    return static_cast<float>(loadedFrames.load()) / static_cast<float>(frameCount);
+}
+
+/*
+ * Decodes a range of the file manually to playback straight from memory (ie: no streaming).
+ * The range is decoded chunk by chunk directly into the left and right sample buffers
+ * which are allocated once, so that only one copy of the audio is held in memory.
+ * The last range goes on until the end of the file.
+ */
+bool Track::decodeRange(ma_decoder& rangeDecoder, DecodeRange& range, bool lastRange)
+{
+    if (range.start > 0 && ma_decoder_seek_to_pcm_frame(&rangeDecoder, range.start) != MA_SUCCESS) {
+        std::cerr << "Failed to seek to PCM frame " << range.start << std::endl;
+        return false;
+    }
+
+    const ma_uint32 channels = rangeDecoder.outputChannels;
+    // Small interleaved buffer reused for every chunk.
+    std::vector<float> chunk(static_cast<size_t>(DECODE_CHUNK_SIZE) * channels);
+    ma_uint64 position = range.start;
+
+    while (!loadCancelled.load(std::memory_order_relaxed)) {
+        ma_uint64 framesToRead = DECODE_CHUNK_SIZE;
+
+        // Stop right where the next range starts.
+        if (!lastRange) {
+            framesToRead = std::min(framesToRead, range.end - position);
+
+            if (framesToRead == 0) {
+                break;
+            }
+        }
+
+        ma_uint64 framesRead = 0;
+        ma_result result = ma_decoder_read_pcm_frames(&rangeDecoder, chunk.data(), framesToRead, &framesRead);
+
+        if (result != MA_SUCCESS && result != MA_AT_END) {
+            std::cerr << "Failed to read PCM frames" << std::endl;
+            return false;
+        }
+
+        // End of file.
+        if (framesRead == 0) {
+            break;
+        }
+
+        // Buffers can only grow when the length is unknown (ie: no loader thread).
+        if (frameCount == 0) {
+            appendChunk(chunk.data(), framesRead, channels);
+        }
+        else {
+            if (position + framesRead > samples.size()) {
+                framesRead = samples.size() - position;
+                result = MA_AT_END;
+            }
+
+            deinterleaveChunk(chunk.data(), framesRead, channels, position);
+        }
+
+        position += framesRead;
+
+        // Publish the newly decoded frames for playback and drawing.
+        range.decoded.store(position - range.start, std::memory_order_release);
+        loadedFrames.fetch_add(framesRead, std::memory_order_relaxed);
+        updateDecodedPrefix();
+
+        if (result == MA_AT_END) {
+            break;
+        }
     }
 
     return true;
 }
 
+/*
+ * Playback can only go as far as the first range not fully decoded.
+ */
+void Track::updateDecodedPrefix()
+{
+    ma_uint64 prefix = 0;
+
+    for (size_t i = 0; i < decodeRangeCount; i++) {
+        const DecodeRange& range = decodeRanges[i];
+        prefix = range.start + range.decoded.load(std::memory_order_acquire);
+
+        if (i + 1 < decodeRangeCount && prefix < range.end) {
+            break;
+        }
+    }
+
+    // Several workers may update concurrently, so only ever move forward.
+    size_t current = totalFrames.load();
+
+    while (prefix > current && !totalFrames.compare_exchange_weak(current, static_cast<size_t>(prefix))) {}
+}
+
+/*
+ * Splits a chunk of interleaved frames into the left and right sample blocks from the given offset.
+ */
+void Track::deinterleaveChunk(const float* src, ma_uint64 frames, ma_uint32 channels, ma_uint64 offset)
+{
+    samples.modify(offset, frames, [=](size_t position, float* left, float* right, size_t count) {
+        const float* chunk = src + (position - offset) * channels;
+
+        if (channels == 1) {
+            std::memcpy(left, chunk, count * sizeof(float));
+            // Mirror for playback.
+            std::memcpy(right, chunk, count * sizeof(float));
+        }
+        // Multichannel: Keep the first 2 channels only.
+        else {
+            for (size_t i = 0; i < count; ++i) {
+                left[i] = chunk[i * channels];
+                right[i] = chunk[i * channels + 1];
+            }
+        }
+    });
+}
+
+/*
+ * Adds a chunk of interleaved frames at the end of the samples (ie: the file length is unknown).
+ */
+void Track::appendChunk(const float* src, ma_uint64 frames, ma_uint32 channels)
+{
+    std::vector<float> left(static_cast<size_t>(frames)), right(static_cast<size_t>(frames));
+    // Mono files are mirrored for playback, multichannel ones keep their first 2 channels.
+    const ma_uint32 rightChannel = channels > 1 ? 1 : 0;
+
+    for (size_t i = 0; i < frames; ++i) {
+        left[i] = src[i * channels];
+        right[i] = src[i * channels + rightChannel];
+    }
+
+    samples.append(left.data(), right.data(), left.size());
+}
+
 void Track::save(const char* filename)
 {
+    if (isLoading()) {
+        std::cout << "The file is still loading." << std::endl;
+        return;
+    }
+
     ma_encoder_config config = ma_encoder_config_init(
         ma_encoding_format_wav,
         ma_format_f32,      // 32-bit float samples
         2,                  // stereo
-        44100               // sample rate (adjust to your app)
+        getSampleRate()     // the file rate (no resampling)
     );
 
+    // The file is written beside the target then renamed over it, so a file the samples are
+    // read from (ie: memory mapped, or a recorded take) is never truncated while it's mapped:
+    // The mapping keeps the previous content until it's released.
+    std::string partFilename = std::string(filename) + ".part";
+
     ma_encoder encoder;
-    if (ma_encoder_init_file(filename, &config, &encoder) != MA_SUCCESS) {
+    if (ma_encoder_init_file(partFilename.c_str(), &config, &encoder) != MA_SUCCESS) {
         printf("Failed to initialize encoder.\n");
         return;
     }
 
-    // Interleave the samples
-    size_t frameCount = leftSamples.size();
-    std::vector<float> interleaved(frameCount * 2);
-    for (size_t i = 0; i < frameCount; ++i) {
-        interleaved[i * 2 + 0] = leftSamples[i];
-        interleaved[i * 2 + 1] = rightSamples[i];
-    }
-
-    // Write audio data
+    // Interleave and write the samples chunk by chunk.
+    size_t frameCount = getFrameCount();
+    std::vector<float> left(DECODE_CHUNK_SIZE), right(DECODE_CHUNK_SIZE);
+    std::vector<float> interleaved(static_cast<size_t>(DECODE_CHUNK_SIZE) * 2);
     ma_uint64 framesWritten = 0;
-    ma_encoder_write_pcm_frames(&encoder, interleaved.data(), frameCount, &framesWritten);
+
+    for (size_t start = 0; start < frameCount; start += DECODE_CHUNK_SIZE) {
+        size_t count = readFrames(start, DECODE_CHUNK_SIZE, left.data(), right.data());
+
+        for (size_t i = 0; i < count; ++i) {
+            interleaved[i * 2 + 0] = left[i];
+            interleaved[i * 2 + 1] = right[i];
+        }
+
+        // Write audio data
+        ma_uint64 written = 0;
+        ma_encoder_write_pcm_frames(&encoder, interleaved.data(), count, &written);
+        framesWritten += written;
+    }
 
     // Clean up
     ma_encoder_uninit(&encoder);
 
+    std::error_code error;
+    std::filesystem::rename(partFilename, filename, error);
+
+    if (error) {
+        std::cerr << "Failed to write " << filename << ": " << error.message() << std::endl;
+        std::filesystem::remove(partFilename, error);
+        return;
+    }
+
     printf("Wrote %llu frames to %s\n", framesWritten, filename);
 }
 
@@ -523,6 +1310,7 @@ bool Track::storeOriginalFileFormat(const char* filename)
 
 void Track::updateTime()
 {
+    getApplication().getTime().setSampleRate(getSampleRate());
     getApplication().getTime().update(playbackSampleIndex.load());
 }
 
@@ -535,6 +1323,24 @@ void Track::render(int x, int y, int w, int h)
     waveform = std::make_unique<Waveform>(x, y + MARKING_AREA_HEIGHT, w, h - MARKING_AREA_HEIGHT, *this, *marking);
     waveform->take_focus();    
     waveform->setStereoMode(isStereo());    
-    waveform->setStereoSamples(getLeftSamples(), getRightSamples());
+
+    if (isLoading()) {
+        // Samples are drawn progressively as they are decoded,
+        // unless the whole waveform can be drawn at once from the peak cache.
+        waveform->setSampleCount(samples.size());
+        waveform->loadPeakCache();
+    }
+    // Samples are read straight from the track.
+    else if (isMapped()) {
+        if (!waveform->loadPeakCache()) {
+            waveform->rebuildPeaks();
+            waveform->savePeakCache();
+        }
+
+        waveform->fitToScreen();
+    }
+    else {
+        waveform->setSamples();
+    }
 }
 
@@ -10,9 +10,16 @@
 #include <thread>
 #include <bits/stdc++.h> // std::map
 #include <time.h>
+#include <semaphore.h>
 #include "../../libraries/miniaudio.h"
 #include "../view/waveform.h"
 #include "engine.h"
+#include "wav_map.h"
+#include "sample_store.h"
+#include "capture_store.h"
+#include "disk_recorder.h"
+#include "edit_list.h"
+#include "resampler.h"
 #include "../marking/marking.h"
 
 // Forward declarations.
@@ -24,6 +31,10 @@ struct TrackOptions {
     const char *filepath = nullptr;
     // New file.
     bool stereo = true;
+    // Edits are kept as a list evaluated on the fly instead of modifying the samples.
+    bool nonDestructive = false;
+    // Used when the file sample rate differs from the output one.
+    Resampler::Quality resamplerQuality = Resampler::Quality::STANDARD;
 };
 
 /*
@@ -39,24 +50,83 @@ class Track {
             ma_format outputFormat;
         };
 
+        // A part of the file decoded independently from the others.
+        struct DecodeRange {
+            ma_uint64 start = 0;
+            ma_uint64 end = 0;
+            // Frames decoded so far from the start of the range.
+            std::atomic<ma_uint64> decoded{0};
+        };
+
         // Track unique id. 0 = invalid.
         unsigned int id = 0;
         ma_context context;
         ma_decoder decoder;
-        ma_uint64 frameCount;
+        ma_decoder_config decoderConfig;
+        ma_uint64 frameCount = 0;
         Engine& engine;
-        std::vector<float> leftSamples;
-        std::vector<float> rightSamples;
-        int totalFrames = 0;
+        SampleStore samples;
+        // Non-destructive edits laid over the samples.
+        EditList editList;
+        bool nonDestructive = false;
+        std::atomic<size_t> totalFrames{0};
         bool stereo = true;
         std::atomic<uint64_t> playbackSampleIndex{0};
         std::atomic<size_t> captureWriteIndex {0};
         std::atomic<bool> playing{false};
+        // Playback is over, waiting for the GUI thread to stop the track.
+        std::atomic<bool> stopping{false};
+        // The position to loop back to and the end of the selection as set by the GUI thread,
+        // so that the audio callback never reads the waveform. They're published with a
+        // sequence number (odd while they're being written), and the audio callback keeps
+        // the previous range whenever it can't read them in one go.
+        struct PlaybackRange {
+            uint64_t loopStart;
+            uint64_t selectionEnd;
+        };
+        static constexpr uint64_t NO_SELECTION_END = UINT64_MAX;
+        std::atomic<uint64_t> playbackLoopStart{0};
+        std::atomic<uint64_t> playbackSelectionEnd{NO_SELECTION_END};
+        std::atomic<unsigned int> playbackRangeSequence{0};
+        // Audio thread only: The last range read.
+        PlaybackRange playbackRange = {0, NO_SELECTION_END};
+        // Mixer settings (set by the GUI thread).
+        std::atomic<float> gain{1.0f};
+        std::atomic<float> pan{0.0f};
+        std::atomic<bool> muted{false};
+        std::atomic<bool> soloed{false};
+        // The channel gains currently applied (audio thread only), smoothly brought to the settings.
+        float leftGain = 1.0f;
+        float rightGain = 1.0f;
+        std::atomic<bool> resetGains{true};
+        // The sample rate of the file (samples are kept at this rate).
+        ma_uint32 sampleRate = 0;
+        // Converts the samples to the output rate while playing (if needed).
+        Resampler resampler;
+        Resampler::Quality resamplerQuality = Resampler::Quality::STANDARD;
+        // Position between 2 frames when resampling (audio thread only).
+        uint32_t playbackFraction = 0;
         std::atomic<bool> paused{false};
         std::atomic<bool> recording{false};
         // The MiniAudio ring buffer (for recording).
         ma_pcm_rb captureRing;                 
+        // The take being recorded, laid over the samples from the position the recording started
+        // until the recording stops.
+        CaptureStore capture;
+        size_t captureStart = 0;
+        std::atomic<bool> capturing{false};
+        // Streams the take to disk while recording (if a file is given).
+        DiskRecorder diskRecorder;
+        std::string recordingFilename;
         std::atomic<size_t> totalRecordedFrames {0};
+        // Posted by the audio thread to wake the capture worker up once enough frames are captured.
+        sem_t captureSignal;
+        std::atomic<bool> captureSignaled{false};
+        // Frames captured since the worker was last woken up (audio thread only).
+        ma_uint32 pendingCaptureFrames = 0;
+        ma_uint32 captureWakeupFrames = 1;
+        // In ms.
+        unsigned int captureWakeup = CAPTURE_WAKEUP_INTERVAL;
         std::thread workerThread;
         std::atomic<bool> workerRunning{false};
         // End of file flag.
@@ -69,26 +139,64 @@ class Track {
         std::atomic<bool> newDataAvailable{false};
         std::atomic<size_t> dirtyStart{SIZE_MAX};
         std::atomic<size_t> dirtyEnd{0};
+        // Background file loading.
+        std::thread loaderThread;
+        std::atomic<bool> loading{false};
+        std::atomic<bool> loadCancelled{false};
+        std::atomic<ma_uint64> loadedFrames{0};
+        // The file is split into ranges decoded in parallel.
+        std::unique_ptr<DecodeRange[]> decodeRanges;
+        size_t decodeRangeCount = 0;
+        unsigned int decoderThreads = 1;
+        // Zero means one decoder thread per hardware thread.
+        unsigned int maxDecoderThreads = 0;
+        // Uncompressed WAV files are read straight from the file until samples get modified
+        // (and then still by the samples which aren't).
+        std::shared_ptr<WavMap> wavMap;
+        std::atomic<bool> mapped{false};
 
         bool storeOriginalFileFormat(const char* filename);
         void uninit();
-        bool decodeFile();
-        void drainAndMergeRingBuffer();
+        bool decodeRange(ma_decoder& rangeDecoder, DecodeRange& range, bool lastRange);
+        void decoderWorkerLoop(std::atomic<size_t>& nextRange);
+        void updateDecodedPrefix();
+        void deinterleaveChunk(const float* src, ma_uint64 frames, ma_uint32 channels, ma_uint64 offset);
+        void appendChunk(const float* src, ma_uint64 frames, ma_uint32 channels);
+        size_t drainAndMergeRingBuffer();
         void workerThreadLoop();
+        void loaderThreadLoop();
+        void markDirty(size_t start, size_t end);
+        void sendPlaybackEvent(Engine::TrackEvent::Type type);
+        void mixBlock(float* output, float* left, float* right, size_t count, float targetLeft, float targetRight);
+        const PlaybackRange& readPlaybackRange();
+        void initResampler();
+        bool mapFile(const char* filename);
+        void mergeCapture();
+        size_t getSourceFrameCount() const;
+        size_t readSourceFrames(size_t start, size_t count, float* left, float* right) const;
 
     public:
-      Track(Engine& e) : engine(e) {}
+      Track(Engine& e);
+      ~Track();
 
       void loadFromFile(const char *fileName);
+      void cancelLoading();
+      void finishLoading();
+      void materialize();
+      void renderEdits();
+      void updateOutputRate();
       void play();
+      void updatePlaybackRange();
       void pause();
       void unpause();
       void stop();
       void record();
-      void mixInto(float* output, int frameCount);
-      void recordInto(const float* input, ma_uint32 frameCount, ma_uint32 captureChannels);
+      void mixInto(float* output, int frameCount, bool soloActive);
+      ma_uint32 recordInto(const float* input, ma_uint32 frameCount, ma_uint32 captureChannels);
       void prepareRecording();
+      void releaseRecordedFrames();
       void render(int x, int y, int w, int h);
+      static void benchmarkDecode(const char* filename);
 
       // Getters.
       std::map<std::string, std::string> getOriginalFileFormat();
@@ -97,16 +205,34 @@ class Track {
       bool isPaused() const { return paused.load(); }
       bool isRecording() const { return recording.load(); }
       bool isEndOfFile() const { return eof.load(); }
+      bool isLoading() const { return loading.load(std::memory_order_acquire); }
+      float getLoadingProgress() const;
+      size_t getDecodeRangeCount() const { return decodeRangeCount; }
+      // Returns the start and the number of frames decoded so far of the given range.
+      std::pair<size_t, size_t> getDecodedRange(size_t index) const {
+          return {decodeRanges[index].start, decodeRanges[index].decoded.load(std::memory_order_acquire)};
+      }
+      bool isMapped() const { return mapped.load(std::memory_order_acquire); }
+      size_t getFrameCount() const { return editList.getFrameCount(getSourceFrameCount()); }
+      size_t readFrames(size_t start, size_t count, float* left, float* right) const;
       bool isNewTrack() const { return newTrack; }
+      const std::string& getFileName() const { return originalFileFormat.fileName; }
+      ma_uint32 getSampleRate() const { return sampleRate ? sampleRate : engine.getDefaultOutputSampleRate(); }
+      ma_uint32 getOutputSampleRate() const { return engine.getDefaultOutputSampleRate(); }
       uint64_t getCurrentSample() const { return playbackSampleIndex.load(); }
-      std::vector<float>& getLeftSamples() { return leftSamples; }
-      std::vector<float>& getRightSamples() { return rightSamples; }
+      SampleStore& getSamples() { return samples; }
+      EditList& getEditList() { return editList; }
+      bool isNonDestructive() const { return nonDestructive; }
+      float getGain() const { return gain.load(); }
+      float getPan() const { return pan.load(); }
+      bool isMuted() const { return muted.load(); }
+      bool isSoloed() const { return soloed.load(); }
       unsigned int getId() const { return id; }
       Waveform& getWaveform() { return *waveform.get(); }
       Marking& getMarking() { return *marking.get(); }
       size_t getTotalRecordedFrames() const { return totalRecordedFrames.load(); }
       size_t getCaptureWriteIndex() const { return captureWriteIndex.load(); }
-      bool getNewSamplesCopy(std::vector<float>& leftCopy, std::vector<float>& rightCopy, size_t& newStartIndex, size_t& newCount);
+      bool getNewSamplesRange(size_t& newStartIndex, size_t& newCount);
       Application& getApplication() const { return engine.getApplication(); }
       void updateTime();
 
@@ -114,7 +240,19 @@ class Track {
       void setNewTrack(TrackOptions options);
       void save(const char* filename);
       void setId(unsigned int i);
-      void setPlaybackSampleIndex(int index) { playbackSampleIndex.store(index); }
+      void setNonDestructive(bool value) { nonDestructive = value; }
+      void setResamplerQuality(Resampler::Quality quality) { resamplerQuality = quality; }
+      // The file the next takes are streamed into (empty = kept in memory only).
+      void setRecordingFilename(const std::string& filename) { recordingFilename = filename; }
+      // The captured time (in ms) the worker waits for before moving the frames into the take.
+      void setCaptureWakeup(unsigned int milliseconds) { captureWakeup = std::max(milliseconds, 1u); }
+      // Linear gain.
+      void setGain(float value) { gain.store(std::max(value, 0.0f)); }
+      // From -1 (left) to 1 (right).
+      void setPan(float value) { pan.store(std::clamp(value, -1.0f, 1.0f)); }
+      void setMuted(bool value) { muted.store(value); }
+      void setSoloed(bool value) { soloed.store(value); }
+      void setPlaybackSampleIndex(uint64_t index) { playbackSampleIndex.store(index); }
       void resetEndOfFile() { eof.store(false); }
 };
 
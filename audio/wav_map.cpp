@@ -0,0 +1,234 @@
+#include "wav_map.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+// WAV files are little-endian.
+static ma_uint32 readU16(const unsigned char* p) { return p[0] | (p[1] << 8); }
+static ma_uint32 readU32(const unsigned char* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((ma_uint32)p[3] << 24); }
+static ma_uint64 readU64(const unsigned char* p) { return readU32(p) | ((ma_uint64)readU32(p + 4) << 32); }
+
+WavMap::~WavMap()
+{
+    close();
+}
+
+/*
+ * Maps the given file into memory. Returns false if the file is not
+ * an uncompressed WAV file that can be read without decoding.
+ */
+bool WavMap::open(const char* filename)
+{
+    close();
+
+    int fd = ::open(filename, O_RDONLY);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    mappingSize = static_cast<size_t>(st.st_size);
+    mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping remains valid once the file descriptor is closed.
+    ::close(fd);
+
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        mappingSize = 0;
+        return false;
+    }
+
+    if (!parse()) {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void WavMap::close()
+{
+    if (mapping != nullptr) {
+        munmap(mapping, mappingSize);
+    }
+
+    mapping = nullptr;
+    mappingSize = 0;
+    data = nullptr;
+    frameCount = 0;
+}
+
+/*
+ * Walks through the RIFF chunks to get the sample format and locate the data chunk.
+ */
+bool WavMap::parse()
+{
+    const unsigned char* p = static_cast<const unsigned char*>(mapping);
+
+    // RF64: Same as RIFF, the sizes beyond 4 GB being given by the ds64 chunk.
+    if (mappingSize < 12 || (std::memcmp(p, "RIFF", 4) != 0 && std::memcmp(p, "RF64", 4) != 0) ||
+        std::memcmp(p + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+
+    ma_uint32 audioFormat = 0;
+    ma_uint32 bitsPerSample = 0;
+    bool hasFormat = false;
+    ma_uint64 dataSize64 = 0;
+    size_t offset = 12;
+
+    while (offset + 8 <= mappingSize) {
+        const unsigned char* chunk = p + offset;
+        ma_uint64 chunkSize = readU32(chunk + 4);
+
+        if (std::memcmp(chunk, "ds64", 4) == 0 && chunkSize >= 24 && offset + 8 + 24 <= mappingSize) {
+            dataSize64 = readU64(chunk + 8 + 8);
+        }
+        else if (std::memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16 && offset + 8 + 16 <= mappingSize) {
+            audioFormat = readU16(chunk + 8);
+            channels = readU16(chunk + 10);
+            sampleRate = readU32(chunk + 12);
+            bitsPerSample = readU16(chunk + 22);
+
+            // WAVE_FORMAT_EXTENSIBLE: The actual format starts the sub format GUID.
+            if (audioFormat == 0xFFFE && chunkSize >= 40 && offset + 8 + 40 <= mappingSize) {
+                audioFormat = readU16(chunk + 8 + 24);
+            }
+
+            hasFormat = true;
+        }
+        else if (std::memcmp(chunk, "data", 4) == 0) {
+            if (!hasFormat) {
+                return false;
+            }
+
+            data = chunk + 8;
+
+            if (chunkSize == 0xFFFFFFFF && dataSize64 > 0) {
+                chunkSize = dataSize64;
+            }
+
+            // Note: The size can be wrong in truncated files or files still being written.
+            size_t dataSize = std::min<size_t>(chunkSize, mappingSize - (offset + 8));
+
+            // 1 = PCM, 3 = IEEE float.
+            if (audioFormat == 1 && bitsPerSample == 16) {
+                format = ma_format_s16;
+            }
+            else if (audioFormat == 1 && bitsPerSample == 24) {
+                format = ma_format_s24;
+            }
+            else if (audioFormat == 1 && bitsPerSample == 32) {
+                format = ma_format_s32;
+            }
+            else if (audioFormat == 3 && bitsPerSample == 32) {
+                format = ma_format_f32;
+            }
+            // Left to the decoder.
+            else {
+                data = nullptr;
+                return false;
+            }
+
+            if (channels == 0) {
+                data = nullptr;
+                return false;
+            }
+
+            bytesPerSample = bitsPerSample / 8;
+            bytesPerFrame = bytesPerSample * channels;
+            frameCount = dataSize / bytesPerFrame;
+
+            return true;
+        }
+
+        // Chunks are word aligned.
+        offset += 8 + static_cast<size_t>(chunkSize) + (chunkSize & 1);
+    }
+
+    return false;
+}
+
+/*
+ * Converts the sample at the given address into float.
+ */
+inline float WavMap::sampleAt(const unsigned char* p) const
+{
+    switch (format) {
+        case ma_format_s16: {
+            int16_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return value * (1.0f / 32768.0f);
+        }
+
+        case ma_format_s24: {
+            // Sign extend the 3 bytes through the upper bits.
+            int32_t value = static_cast<int32_t>((ma_uint32)p[0] << 8 | (ma_uint32)p[1] << 16 | (ma_uint32)p[2] << 24) >> 8;
+            return value * (1.0f / 8388608.0f);
+        }
+
+        case ma_format_s32: {
+            int32_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return static_cast<float>(value * (1.0 / 2147483648.0));
+        }
+
+        case ma_format_f32: {
+            float value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        default:
+            return 0.0f;
+    }
+}
+
+/*
+ * Converts the given range of frames into the left and right buffers (either of them can be null).
+ * Mono files are mirrored on the right channel and only the first 2 channels of
+ * a multichannel file are used. Returns the number of frames actually read.
+ */
+ma_uint64 WavMap::read(ma_uint64 start, ma_uint64 count, float* left, float* right) const
+{
+    if (data == nullptr || start >= frameCount) {
+        return 0;
+    }
+
+    count = std::min(count, frameCount - start);
+    const unsigned char* p = data + start * bytesPerFrame;
+    const ma_uint32 rightOffset = channels > 1 ? bytesPerSample : 0;
+
+    // Most common case (no conversion needed).
+    if (format == ma_format_f32 && left != nullptr && right != nullptr) {
+        for (ma_uint64 i = 0; i < count; ++i, p += bytesPerFrame) {
+            std::memcpy(&left[i], p, sizeof(float));
+            std::memcpy(&right[i], p + rightOffset, sizeof(float));
+        }
+
+        return count;
+    }
+
+    for (ma_uint64 i = 0; i < count; ++i, p += bytesPerFrame) {
+        if (left != nullptr) {
+            left[i] = sampleAt(p);
+        }
+
+        if (right != nullptr) {
+            right[i] = sampleAt(p + rightOffset);
+        }
+    }
+
+    return count;
+}
@@ -0,0 +1,46 @@
+#ifndef WAV_MAP_H
+#define WAV_MAP_H
+
+#include <cstddef>
+#include "../../libraries/miniaudio.h"
+
+/*
+ * Gives a read-only access to the samples of an uncompressed WAV or RF64 file (PCM or 32-bit float)
+ * through a memory mapping of the file. Samples are converted to float only when read, so
+ * opening a file costs nothing whatever its size and the file is never loaded into memory.
+ */
+class WavMap {
+        void* mapping = nullptr;
+        size_t mappingSize = 0;
+        // Start of the data chunk in the mapping.
+        const unsigned char* data = nullptr;
+        ma_uint64 frameCount = 0;
+        ma_uint32 channels = 0;
+        ma_uint32 sampleRate = 0;
+        ma_uint32 bytesPerSample = 0;
+        ma_uint32 bytesPerFrame = 0;
+        ma_format format = ma_format_unknown;
+
+        bool parse();
+        float sampleAt(const unsigned char* p) const;
+
+    public:
+        WavMap() = default;
+        ~WavMap();
+        // Not copyable (owns the mapping).
+        WavMap(const WavMap&) = delete;
+        WavMap& operator=(const WavMap&) = delete;
+
+        bool open(const char* filename);
+        void close();
+        ma_uint64 read(ma_uint64 start, ma_uint64 count, float* left, float* right) const;
+
+        // Getters.
+        bool isOpen() const { return data != nullptr; }
+        ma_uint64 getFrameCount() const { return frameCount; }
+        ma_uint32 getChannels() const { return channels; }
+        ma_uint32 getSampleRate() const { return sampleRate; }
+        ma_format getFormat() const { return format; }
+};
+
+#endif // WAV_MAP_H
@@ -0,0 +1,97 @@
+#include "worker_pool.h"
+#include <algorithm>
+
+WorkerPool::WorkerPool(unsigned int threadCount)
+{
+    for (unsigned int i = 0; i < threadCount; i++) {
+        threads.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    wakeUp.notify_all();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+/*
+ * Returns the pool shared by the whole application (one worker per extra CPU core).
+ */
+WorkerPool& WorkerPool::getInstance()
+{
+    static WorkerPool pool(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+
+    return pool;
+}
+
+void WorkerPool::runTasks()
+{
+    for (size_t index = nextTask.fetch_add(1); index < taskCount; index = nextTask.fetch_add(1)) {
+        (*task)(index);
+    }
+}
+
+void WorkerPool::workerLoop()
+{
+    unsigned long lastJob = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        wakeUp.wait(lock, [&] { return stopping || jobNumber != lastJob; });
+
+        if (stopping) {
+            return;
+        }
+
+        lastJob = jobNumber;
+        lock.unlock();
+        runTasks();
+        lock.lock();
+
+        if (--busyWorkers == 0) {
+            finished.notify_one();
+        }
+    }
+}
+
+/*
+ * Calls the given task for each index from 0 to count - 1, spread over the threads,
+ * and returns when all the calls are done.
+ */
+void WorkerPool::parallelFor(size_t count, const std::function<void(size_t)>& task)
+{
+    if (threads.empty() || count < 2) {
+        for (size_t i = 0; i < count; i++) {
+            task(i);
+        }
+
+        return;
+    }
+
+    std::lock_guard<std::mutex> job(jobMutex);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->task = &task;
+        taskCount = count;
+        nextTask.store(0);
+        busyWorkers = threads.size();
+        jobNumber++;
+    }
+
+    wakeUp.notify_all();
+    // Take part in the job.
+    runTasks();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return busyWorkers == 0; });
+    this->task = nullptr;
+}
@@ -0,0 +1,46 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+/*
+ * Pool of threads sharing out the tasks of a job (eg: the parts of a long selection
+ * to edit). The calling thread takes part in the job and returns once it's done.
+ */
+class WorkerPool {
+        std::vector<std::thread> threads;
+        std::mutex mutex;
+        std::condition_variable wakeUp;
+        std::condition_variable finished;
+        // Only one job at a time.
+        std::mutex jobMutex;
+        // The current job.
+        const std::function<void(size_t)>* task = nullptr;
+        size_t taskCount = 0;
+        std::atomic<size_t> nextTask{0};
+        // The number of workers still busy with the current job.
+        size_t busyWorkers = 0;
+        unsigned long jobNumber = 0;
+        bool stopping = false;
+
+        void workerLoop();
+        void runTasks();
+
+    public:
+        WorkerPool(unsigned int threadCount);
+        ~WorkerPool();
+        // Not copyable (owns the threads).
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        static WorkerPool& getInstance();
+        void parallelFor(size_t count, const std::function<void(size_t)>& task);
+        size_t getThreadCount() const { return threads.size() + 1; }
+};
+
+#endif // WORKER_POOL_H
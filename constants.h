@@ -18,12 +18,29 @@ constexpr unsigned int TEXT_SIZE = 13;
 constexpr unsigned int SCROLLBAR_HEIGHT = 15;
 constexpr unsigned int SCROLLBAR_MARGIN = 10;
 constexpr unsigned int INITIAL_BUFFER_SIZE = 10; // In seconds
+constexpr unsigned int DECODE_CHUNK_SIZE = 65536; // In frames
+constexpr unsigned int SAMPLE_BLOCK_SIZE = 65536; // In frames
+constexpr unsigned int DECODE_MIN_RANGE_SIZE = 1048576; // In frames
+constexpr unsigned int DECODE_RANGES_PER_THREAD = 4;
+constexpr unsigned int DECODE_SEEK_POINTS = 1024;
+constexpr unsigned int PARALLEL_EDIT_MIN_SIZE = 262144; // In frames
+constexpr unsigned int MIX_BLOCK_SIZE = 256; // In frames
+constexpr unsigned int GAIN_SMOOTHING_FRAMES = 2048; // In frames
+constexpr unsigned int PEAK_BLOCK_SIZE = 64; // In samples
+constexpr unsigned int PEAK_CACHE_HASH_SIZE = 1048576; // In bytes
+constexpr unsigned int HISTORY_MEMORY_BUDGET = 512; // In MB (per document)
+constexpr unsigned int RECORDING_BUFFER_SIZE = 16384; // In frames
+constexpr unsigned int RECORDING_HEADER_INTERVAL = 1; // In seconds
+constexpr unsigned int RECORDING_MEMORY_WINDOW = 30; // In seconds
+constexpr unsigned int CAPTURE_WAKEUP_INTERVAL = 20; // In ms
+constexpr unsigned int CAPTURE_WAKEUP_TIMEOUT = 100; // In ms
 constexpr unsigned int MARKING_AREA_HEIGHT = 40;
 constexpr unsigned int MARKER_WIDTH = 60;
 constexpr unsigned int MARKER_HEIGHT = 20;
 constexpr unsigned int TAB_BORDER_THICKNESS = 10;
 constexpr float VU_METER_DECAY_TIME = 1.0f;
 constexpr const char* CONFIG_FILENAME = "config.json";
+constexpr const char* RECORDINGS_DIRECTORY = "recordings";
 
 // --- Custom types ---
 
@@ -49,7 +66,7 @@ enum class MenuItemID {
 };
 
 struct Selection {
-    int start, end;
+    size_t start, end;
 };
 
 inline std::map<EditID, std::string> EditLabels {
@@ -23,6 +23,28 @@ void SettingsDialog::buildDialog()
     output->align(FL_ALIGN_TOP | FL_ALIGN_LEFT);
     input->align(FL_ALIGN_TOP | FL_ALIGN_LEFT);
 
+    // Memory budget of the edit history.
+    historyBudget = new Fl_Spinner(SMALL_SPACE, (TINY_SPACE * 2) * 9 + MICRO_SPACE, MEDIUM_SPACE, height, "History memory per document (MB, 0 = no limit)");
+    historyBudget->align(FL_ALIGN_TOP | FL_ALIGN_LEFT);
+    historyBudget->type(FL_INT_INPUT);
+    historyBudget->range(0, 1048576);
+    historyBudget->step(64);
+    historyBudget->value(pApplication->loadConfig(CONFIG_FILENAME).historyBudget);
+    historyUsage = new Fl_Box(SMALL_SPACE, (TINY_SPACE * 2) * 11, XLARGE_SPACE, height);
+    historyUsage->align(FL_ALIGN_INSIDE | FL_ALIGN_LEFT);
+
+    // Edits laid over the samples rather than applied to them.
+    nonDestructive = new Fl_Check_Button(SMALL_SPACE, (TINY_SPACE * 2) * 13, XLARGE_SPACE, height, "Non-destructive editing (new documents)");
+    nonDestructive->value(pApplication->loadConfig(CONFIG_FILENAME).nonDestructiveEditing);
+
+    // Used to play files which sample rate differs from the output one.
+    resamplerQuality = new Fl_Choice(SMALL_SPACE, (TINY_SPACE * 2) * 15 + TINY_SPACE, XLARGE_SPACE, height, "Resampling quality (new documents)");
+    resamplerQuality->align(FL_ALIGN_TOP | FL_ALIGN_LEFT);
+    resamplerQuality->add("Linear (fastest)");
+    resamplerQuality->add("Standard");
+    resamplerQuality->add("High (best)");
+    resamplerQuality->value(pApplication->loadConfig(CONFIG_FILENAME).resamplerQuality);
+
     backend->callback([](Fl_Widget*, void* userdata) {
         static_cast<SettingsDialog*>(userdata)->onChangeBackend();
     }, this);
@@ -39,10 +61,93 @@ void SettingsDialog::buildDialog()
         buildDevices();
     }
 
+    // Device settings on the right.
+    buildDeviceSettings(SMALL_SPACE * 2 + XLARGE_SPACE, height);
+
     // Add the Ok/Cancel buttons.
     addDefaultButtons();
 }
 
+namespace {
+    // Options of the device drop down lists (0 = backend default).
+    const unsigned int sampleRates[] = {44100, 48000, 88200, 96000};
+    const unsigned int periodSizes[] = {0, 64, 128, 256, 512, 1024, 2048};
+    const unsigned int periodCounts[] = {0, 2, 3, 4};
+}
+
+/*
+ * Creates the sample rate, period and performance profile drop down lists.
+ */
+void SettingsDialog::buildDeviceSettings(int x, int height)
+{
+    auto config = pApplication->loadConfig(CONFIG_FILENAME);
+
+    sampleRate = new Fl_Choice(x, TINY_SPACE * 3, LARGE_SPACE, height, "Sample rate (Hz)");
+    periodSize = new Fl_Choice(x, (TINY_SPACE * 2) * 4, LARGE_SPACE, height, "Period size (frames)");
+    periodCount = new Fl_Choice(x, (TINY_SPACE * 2) * 6 + TINY_SPACE, LARGE_SPACE, height, "Periods");
+    profile = new Fl_Choice(x, (TINY_SPACE * 2) * 9 + MICRO_SPACE, LARGE_SPACE, height, "Performance profile");
+    latency = new Fl_Box(x, (TINY_SPACE * 2) * 11, XLARGE_SPACE, height);
+    sampleRate->align(FL_ALIGN_TOP | FL_ALIGN_LEFT);
+    periodSize->align(FL_ALIGN_TOP | FL_ALIGN_LEFT);
+    periodCount->align(FL_ALIGN_TOP | FL_ALIGN_LEFT);
+    profile->align(FL_ALIGN_TOP | FL_ALIGN_LEFT);
+    latency->align(FL_ALIGN_INSIDE | FL_ALIGN_LEFT);
+
+    for (size_t i = 0; i < sizeof(sampleRates) / sizeof(sampleRates[0]); i++) {
+        sampleRate->add(std::to_string(sampleRates[i]).c_str());
+
+        if (sampleRates[i] == config.sampleRate) {
+            sampleRate->value(i);
+        }
+    }
+
+    for (size_t i = 0; i < sizeof(periodSizes) / sizeof(periodSizes[0]); i++) {
+        periodSize->add(periodSizes[i] ? std::to_string(periodSizes[i]).c_str() : "Default");
+
+        if (periodSizes[i] == config.periodSize) {
+            periodSize->value(i);
+        }
+    }
+
+    for (size_t i = 0; i < sizeof(periodCounts) / sizeof(periodCounts[0]); i++) {
+        periodCount->add(periodCounts[i] ? std::to_string(periodCounts[i]).c_str() : "Default");
+
+        if (periodCounts[i] == config.periodCount) {
+            periodCount->value(i);
+        }
+    }
+
+    profile->add("Low latency");
+    profile->add("Conservative");
+    profile->value(config.performanceProfile == "conservative" ? 1 : 0);
+
+    // Takes are streamed into files as they're recorded.
+    recordToDisk = new Fl_Check_Button(x, (TINY_SPACE * 2) * 13, XLARGE_SPACE, height, "Record to disk (recordings directory)");
+    recordToDisk->value(config.recordToDisk);
+
+    // How often the recorded frames are moved out of the capture buffer.
+    captureWakeup = new Fl_Spinner(x, (TINY_SPACE * 2) * 15 + TINY_SPACE, MEDIUM_SPACE, height, "Recording batch (ms)");
+    captureWakeup->align(FL_ALIGN_TOP | FL_ALIGN_LEFT);
+    captureWakeup->type(FL_INT_INPUT);
+    captureWakeup->range(1, 1000);
+    captureWakeup->step(5);
+    captureWakeup->value(config.captureWakeup);
+}
+
+unsigned int SettingsDialog::getSampleRate() const { return sampleRates[std::max(sampleRate->value(), 0)]; }
+unsigned int SettingsDialog::getPeriodSize() const { return periodSizes[std::max(periodSize->value(), 0)]; }
+unsigned int SettingsDialog::getPeriodCount() const { return periodCounts[std::max(periodCount->value(), 0)]; }
+std::string SettingsDialog::getPerformanceProfile() const { return profile->value() == 1 ? "conservative" : "low latency"; }
+
+/*
+ * Displays the latency the output device actually got.
+ */
+void SettingsDialog::updateLatency()
+{
+    latencyLabel = "Latency: " + pApplication->getEngine().getLatencyReport();
+    latency->label(latencyLabel.c_str());
+}
+
 void SettingsDialog::onButtonsCreated() 
 {
     // Change the OK button's label.
@@ -61,6 +166,19 @@ void SettingsDialog::onCancel()
     Dialog::onCancel();
 }
 
+/*
+ * Displays the memory and disk space currently taken by the edit history.
+ */
+void SettingsDialog::updateHistoryUsage()
+{
+    size_t memory = 0, disk = 0;
+    pApplication->getHistoryUsage(memory, disk);
+
+    historyUsageLabel = "History: " + std::to_string(memory >> 20) + " MB in memory, " +
+                        std::to_string(disk >> 20) + " MB on disk";
+    historyUsage->label(historyUsageLabel.c_str());
+}
+
 void SettingsDialog::buildBackends()
 {
     // Get the required variables.
@@ -174,6 +292,15 @@ void SettingsDialog::save()
     config.backend = backend->text();
     config.outputDevice = output->text();
     config.inputDevice = input->text();
+    config.historyBudget = static_cast<unsigned int>(historyBudget->value());
+    config.nonDestructiveEditing = nonDestructive->value();
+    config.resamplerQuality = static_cast<unsigned int>(resamplerQuality->value());
+    config.sampleRate = getSampleRate();
+    config.periodSize = getPeriodSize();
+    config.periodCount = getPeriodCount();
+    config.performanceProfile = getPerformanceProfile();
+    config.recordToDisk = recordToDisk->value();
+    config.captureWakeup = static_cast<unsigned int>(captureWakeup->value());
     pApplication->saveConfig(config, CONFIG_FILENAME);
 }
 
@@ -2,6 +2,9 @@
 #define SETTINGS_H
 
 #include <FL/Fl_Choice.H>
+#include <FL/Fl_Spinner.H>
+#include <FL/Fl_Box.H>
+#include <FL/Fl_Check_Button.H>
 #include <string>
 #include "dialog.h"
 
@@ -16,14 +19,39 @@ class SettingsDialog : public Dialog
       Fl_Choice& getBackend() const { return *backend; }
       Fl_Choice& getInput() const { return *input; }
       Fl_Choice& getOutput() const { return *output; }
+      Fl_Spinner& getHistoryBudget() const { return *historyBudget; }
+      Fl_Check_Button& getNonDestructive() const { return *nonDestructive; }
+      Fl_Choice& getResamplerQuality() const { return *resamplerQuality; }
+      Fl_Check_Button& getRecordToDisk() const { return *recordToDisk; }
+      Fl_Spinner& getCaptureWakeup() const { return *captureWakeup; }
+      unsigned int getSampleRate() const;
+      unsigned int getPeriodSize() const;
+      unsigned int getPeriodCount() const;
+      std::string getPerformanceProfile() const;
+      void updateHistoryUsage();
+      void updateLatency();
 
   private:
       Application* pApplication;
       Fl_Choice* backend = nullptr;
       Fl_Choice* input = nullptr;
       Fl_Choice* output = nullptr;
+      Fl_Spinner* historyBudget = nullptr;
+      Fl_Box* historyUsage = nullptr;
+      Fl_Check_Button* nonDestructive = nullptr;
+      Fl_Choice* resamplerQuality = nullptr;
+      Fl_Choice* sampleRate = nullptr;
+      Fl_Choice* periodSize = nullptr;
+      Fl_Choice* periodCount = nullptr;
+      Fl_Choice* profile = nullptr;
+      Fl_Box* latency = nullptr;
+      Fl_Check_Button* recordToDisk = nullptr;
+      Fl_Spinner* captureWakeup = nullptr;
+      std::string latencyLabel;
+      std::string historyUsageLabel;
 
       void buildBackends();
+      void buildDeviceSettings(int x, int height);
       void buildDevices();
       void onChangeBackend();
       void onChangeOutput();
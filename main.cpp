@@ -73,6 +73,11 @@ Application::Application(int w, int h, const char *l, int argc, char *argv[]) :
         vuMeters->end();
 
         time = new Time((TINY_SPACE * 8) + (MEDIUM_SPACE * 10), SMALL_SPACE + TINY_SPACE, LARGE_SPACE, SMALL_SPACE, "00:00:00");
+        dspLoad = new Fl_Box((TINY_SPACE * 9) + (MEDIUM_SPACE * 10) + LARGE_SPACE, SMALL_SPACE + MICRO_SPACE, LARGE_SPACE - (TINY_SPACE * 2), SMALL_SPACE + MICRO_SPACE);
+        dspLoad->align(FL_ALIGN_INSIDE | FL_ALIGN_LEFT);
+        dspLoad->labelsize(TEXT_SIZE - 2);
+        dspLoad->tooltip("Audio callback load (last 0.5 s and peak) and number of late callbacks and capture overruns.\n"
+                         "Help/Audio statistics prints the details.");
     toolbar->end();
 
     // Create tabs container
@@ -94,6 +99,27 @@ Application::Application(int w, int h, const char *l, int argc, char *argv[]) :
 
 int main(int argc, char *argv[])
 {
+    // Measure the edit kernels of each CPU variant then quit.
+    if (argc > 1 && strcmp(argv[1], "--benchmark-kernels") == 0) {
+        Kernels::benchmark();
+        return 0;
+    }
+
+    // Measure the speed and accuracy of the resampler qualities then quit.
+    if (argc > 1 && strcmp(argv[1], "--benchmark-resampler") == 0) {
+        Resampler::benchmark();
+        return 0;
+    }
+
+    // Measure the decoding of the given file with one thread and with all of them then quit.
+    if (argc > 2 && strcmp(argv[1], "--benchmark-decode") == 0) {
+        Track::benchmarkDecode(argv[2]);
+        return 0;
+    }
+
+    // Enable the FLTK multithreading support (the audio callback wakes the GUI up with Fl::awake).
+    Fl::lock();
+
     Application app(1200, 800, "Audio Editor", argc, argv);
     app.initAudioSystem();
 
@@ -15,6 +15,7 @@
 #include "constants.h"
 #include "application/tabs.h"
 #include "audio/engine.h"
+#include "audio/kernels.h"
 #include "widgets/vu_meter.h"
 #include "widgets/time.h"
 #include "application/document.h"
@@ -44,6 +45,11 @@ class Application : public Fl_Double_Window
     VuMeter* vuMeterL = nullptr;
     VuMeter* vuMeterR = nullptr;
     Time* time = nullptr;
+    // Load of the audio callbacks and number of xruns.
+    Fl_Box* dspLoad = nullptr;
+    std::string dspLoadLabel;
+    // The stats as they were at the previous update of the DSP load.
+    CallbackStats::Snapshot lastCallbackStats;
     Engine* engine = nullptr;
     Tabs* tabs = nullptr;
     // Stores menu item labels to prevent trash characters (eg: ^$¨)
@@ -52,12 +58,30 @@ class Application : public Fl_Double_Window
     std::string message;
     // The number of new documents in tabs.
     unsigned int newDocuments = 0;
-    bool loop = false;
+    // Read by the audio callback.
+    std::atomic<bool> loop{false};
 
     struct AppConfig {
         std::string backend;
         std::string outputDevice;
         std::string inputDevice;
+        // In MB (0 = no limit).
+        unsigned int historyBudget = HISTORY_MEMORY_BUDGET;
+        // Applies to the documents opened afterwards.
+        bool nonDestructiveEditing = false;
+        // 0 = linear, 1 = standard, 2 = high (applies to the documents opened afterwards).
+        unsigned int resamplerQuality = 1;
+        // Device settings (0 = backend default).
+        unsigned int sampleRate = 44100;
+        unsigned int periodSize = 0;
+        unsigned int periodCount = 0;
+        // "low latency" or "conservative".
+        std::string performanceProfile = "low latency";
+        // Stream the takes into the recordings directory as they're recorded.
+        bool recordToDisk = false;
+        std::string recordingDirectory = RECORDINGS_DIRECTORY;
+        // The captured time (in ms) the recording worker waits for before storing the frames.
+        unsigned int captureWakeup = CAPTURE_WAKEUP_INTERVAL;
         //std::string volume;
     };
 
@@ -97,6 +121,9 @@ class Application : public Fl_Double_Window
         std::string escapeMenuText(const std::string& input);
         Fl_Button& getButton(const char* name);
         void documentHasChanged(unsigned int trackId);
+        void setHistoryBudget(unsigned int megabytes);
+        void restartDevices();
+        void getHistoryUsage(size_t& memory, size_t& disk) const;
         unsigned int checkChangedDocuments();
         Document& getDocumentByTrackId(unsigned int trackId);
         void setSupportedFormats();
@@ -107,7 +134,7 @@ class Application : public Fl_Double_Window
         void onPause(Track& track);
         void onRecord(Track& track);
         void onLoop();
-        bool isLooped() const { return loop; }
+        bool isLooped() const { return loop.load(); }
         int handle(int event) override;
         void onMute(Track& track);
         void onFadeIn(Track& track);
@@ -142,6 +169,7 @@ class Application : public Fl_Double_Window
         static void update_vu_cb(void* data);
         static void insert_marker_cb(Fl_Widget* w, void* data);
         static void time_cb(void* data);
+        static void dsp_load_cb(void* data);
 };
 
 #endif
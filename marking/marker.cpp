@@ -9,12 +9,12 @@ void Marker::alignX(int x)
     position(marking.x() + x, marking.y() + (MARKING_AREA_HEIGHT - MARKER_HEIGHT));
 }
 
-int Marker::getNewSamplePosition(int newX)
+size_t Marker::getNewSamplePosition(int newX)
 {
     // Get the new sample position out of the new x value, the scroll offset and the zoom level. 
-    int samplePos = marking.getWaveform().getScrollOffset() + static_cast<int>((newX - TAB_BORDER_THICKNESS) / marking.getWaveform().getZoomLevel());
+    size_t samplePos = marking.getWaveform().getSampleAt(newX - static_cast<int>(TAB_BORDER_THICKNESS));
     // Clamp within sample range
-    samplePos = std::clamp(samplePos, 0, (int)marking.getWaveform().getTrack().getLeftSamples().size() - 1);
+    samplePos = std::min(samplePos, std::max<size_t>(marking.getWaveform().getTrack().getFrameCount(), 1) - 1);
 
     return samplePos;
 }
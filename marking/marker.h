@@ -14,13 +14,13 @@ class Marking;
 class Marker : public Fl_Box {
         unsigned int id = 0;
         Marking& marking;
-        int samplePosition = -1;
+        size_t samplePosition = 0;
         bool dragging = false;
         int dragStartX;
         RenamingDialog* renamingDlg = nullptr;
         Fl_Menu_Button* menu = nullptr;
 
-        int getNewSamplePosition(int x);
+        size_t getNewSamplePosition(int x);
         void createMenu();
 
     public:
@@ -32,11 +32,11 @@ class Marker : public Fl_Box {
             box(FL_FLAT_BOX);
         }
 
-        void setSamplePosition(int position) { samplePosition = position; }
+        void setSamplePosition(size_t position) { samplePosition = position; }
         void alignX(int x);
         int handle(int event) override;
         unsigned int getId() { return id; }
-        int getSamplePosition() { return samplePosition; }
+        size_t getSamplePosition() { return samplePosition; }
         bool isDragging() const { return dragging; }
 };
 
@@ -20,7 +20,7 @@ unsigned int Marking::getNewMarkerId()
     return highestId + 1;
 }
 
-void Marking::insertMarker(int samplePosition)
+void Marking::insertMarker(size_t samplePosition)
 {
     unsigned int newId = getNewMarkerId();
     Marker* marker = new Marker(0, 0, MARKER_WIDTH, MARKER_HEIGHT, 0, newId, *this);
@@ -28,7 +28,7 @@ void Marking::insertMarker(int samplePosition)
     std::string label = "Mark " + std::to_string(newId);
     marker->copy_label(label.c_str());
     marker->setSamplePosition(samplePosition);
-    float x = (samplePosition - pWaveform->getScrollOffset()) * pWaveform->getZoomLevel();
+    float x = pWaveform->getSampleX(samplePosition);
     marker->alignX((int) x);
     // Add the new marker to the parent widget.
     add(marker);
@@ -29,7 +29,7 @@ class Marking : public Fl_Group {
         Waveform& getWaveform() { return *pWaveform; }
         // Markers can be read but not owned (ie: modified).
         const std::vector<Marker*>& getMarkers() const { return markers; }
-        void insertMarker(int samplePosition);
+        void insertMarker(size_t samplePosition);
         void deleteMarker(unsigned int id);
 };
 
@@ -0,0 +1,222 @@
+#include "peak_cache.h"
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include "../constants.h"
+
+// Identifies a peak cache file and its layout.
+static const char PEAK_CACHE_MAGIC[4] = {'P', 'E', 'A', 'K'};
+static const uint32_t PEAK_CACHE_VERSION = 1;
+
+/*
+ * Returns the directory of the cache files (ie: $XDG_CACHE_HOME/audio-editor/peaks).
+ */
+static std::filesystem::path cacheDirectory()
+{
+    if (const char* cache = getenv("XDG_CACHE_HOME")) {
+        return std::filesystem::path(cache) / "audio-editor" / "peaks";
+    }
+
+    const char* home = getenv("HOME") ? getenv("HOME") : ".";
+
+    return std::filesystem::path(home) / ".cache" / "audio-editor" / "peaks";
+}
+
+// 64-bit FNV-1a.
+static uint64_t fnv1a(const char* data, size_t size, uint64_t hash)
+{
+    for (size_t i = 0; i < size; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+template <typename T>
+static void writeValue(std::ofstream& out, const T& value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static bool readValue(std::ifstream& in, T& value)
+{
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+PeakCache::PeakCache(const std::string& filename, uint32_t rate)
+    : sampleRate(rate)
+{
+    std::error_code error;
+    std::filesystem::path path = std::filesystem::canonical(filename, error);
+
+    if (error) {
+        return;
+    }
+
+    audioFile = path.string();
+    fileSize = std::filesystem::file_size(path, error);
+
+    if (error) {
+        return;
+    }
+
+    modificationTime = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+
+    if (error || !hashContent()) {
+        return;
+    }
+
+    // One cache file per audio file path.
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.peaks", static_cast<unsigned long long>(std::hash<std::string>{}(audioFile)));
+    cacheFile = cacheDirectory() / name;
+    valid = true;
+}
+
+/*
+ * Hashes the beginning and the end of the file. Hashing the whole content would take
+ * as long as scanning the samples, size and modification time catch the other changes.
+ */
+bool PeakCache::hashContent()
+{
+    std::ifstream in(audioFile, std::ios::binary);
+
+    if (!in) {
+        return false;
+    }
+
+    std::vector<char> buffer(PEAK_CACHE_HASH_SIZE);
+    uint64_t hash = 14695981039346656037ULL;
+
+    in.read(buffer.data(), buffer.size());
+    hash = fnv1a(buffer.data(), static_cast<size_t>(in.gcount()), hash);
+
+    if (fileSize > PEAK_CACHE_HASH_SIZE * 2) {
+        in.clear();
+        in.seekg(static_cast<std::streamoff>(fileSize - PEAK_CACHE_HASH_SIZE));
+        in.read(buffer.data(), buffer.size());
+        hash = fnv1a(buffer.data(), static_cast<size_t>(in.gcount()), hash);
+    }
+
+    contentHash = hash;
+
+    return true;
+}
+
+/*
+ * Loads the cached peaks of both channels. Returns false if there is no cache file
+ * or if it doesn't match the audio file anymore.
+ */
+bool PeakCache::load(PeakPyramid& left, PeakPyramid& right, size_t sampleCount) const
+{
+    if (!valid) {
+        return false;
+    }
+
+    std::ifstream in(cacheFile, std::ios::binary);
+
+    if (!in) {
+        return false;
+    }
+
+    char magic[4];
+    uint32_t version, rate, pathLength;
+    uint64_t size, hash, count;
+    int64_t time;
+
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, PEAK_CACHE_MAGIC, sizeof(magic)) != 0 ||
+        !readValue(in, version) || version != PEAK_CACHE_VERSION ||
+        !readValue(in, rate) || rate != sampleRate ||
+        !readValue(in, size) || size != fileSize ||
+        !readValue(in, time) || time != modificationTime ||
+        !readValue(in, hash) || hash != contentHash ||
+        !readValue(in, pathLength) || pathLength != audioFile.size()) {
+        return false;
+    }
+
+    // Different paths may share the same cache file name.
+    std::string path(pathLength, '\0');
+
+    if (!in.read(path.data(), pathLength) || path != audioFile || !readValue(in, count) || count != sampleCount) {
+        return false;
+    }
+
+    PeakPyramid* channels[2] = {&left, &right};
+
+    for (PeakPyramid* channel : channels) {
+        uint64_t blockCount;
+
+        if (!readValue(in, blockCount) || blockCount != (sampleCount + PEAK_BLOCK_SIZE - 1) / PEAK_BLOCK_SIZE) {
+            return false;
+        }
+
+        std::vector<Peak> blocks(static_cast<size_t>(blockCount));
+
+        if (!in.read(reinterpret_cast<char*>(blocks.data()), blocks.size() * sizeof(Peak)) ||
+            !channel->setBaseLevel(sampleCount, std::move(blocks))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Writes the level 0 peaks of both channels (the levels above are quickly rebuilt from it).
+ */
+bool PeakCache::save(const PeakPyramid& left, const PeakPyramid& right) const
+{
+    if (!valid || left.getLevels().empty() || right.getLevels().empty()) {
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(cacheFile.parent_path(), error);
+
+    if (error) {
+        std::cerr << "Failed to create peak cache directory: " << error.message() << std::endl;
+        return false;
+    }
+
+    // Write to a temporary file first so that a cache file is never left half written.
+    std::filesystem::path temporary = cacheFile;
+    temporary += ".tmp";
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+
+    if (!out) {
+        std::cerr << "Failed to write peak cache: " << temporary << std::endl;
+        return false;
+    }
+
+    out.write(PEAK_CACHE_MAGIC, sizeof(PEAK_CACHE_MAGIC));
+    writeValue(out, PEAK_CACHE_VERSION);
+    writeValue(out, sampleRate);
+    writeValue(out, fileSize);
+    writeValue(out, modificationTime);
+    writeValue(out, contentHash);
+    writeValue(out, static_cast<uint32_t>(audioFile.size()));
+    out.write(audioFile.data(), audioFile.size());
+    writeValue(out, static_cast<uint64_t>(left.getSampleCount()));
+
+    for (const PeakPyramid* channel : {&left, &right}) {
+        const std::vector<Peak>& blocks = channel->getLevels()[0];
+        writeValue(out, static_cast<uint64_t>(blocks.size()));
+        out.write(reinterpret_cast<const char*>(blocks.data()), blocks.size() * sizeof(Peak));
+    }
+
+    out.close();
+
+    if (!out) {
+        std::cerr << "Failed to write peak cache: " << temporary << std::endl;
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+
+    std::filesystem::rename(temporary, cacheFile, error);
+
+    return !error;
+}
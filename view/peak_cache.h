@@ -0,0 +1,36 @@
+#ifndef PEAK_CACHE_H
+#define PEAK_CACHE_H
+
+#include <string>
+#include <cstdint>
+#include <filesystem>
+#include "peak_pyramid.h"
+
+/*
+ * Saves the peaks of an audio file in a cache directory, so that the waveform of a file
+ * opened again is drawn at once instead of scanning all of its samples.
+ * A cache file is only used while the audio file keeps the same path, size,
+ * modification time and content hash, and is decoded at the same sample rate.
+ */
+class PeakCache {
+        std::string audioFile;
+        std::filesystem::path cacheFile;
+        uint32_t sampleRate = 0;
+        uint64_t fileSize = 0;
+        int64_t modificationTime = 0;
+        uint64_t contentHash = 0;
+        bool valid = false;
+
+        bool hashContent();
+
+    public:
+        PeakCache(const std::string& filename, uint32_t rate);
+
+        bool load(PeakPyramid& left, PeakPyramid& right, size_t sampleCount) const;
+        bool save(const PeakPyramid& left, const PeakPyramid& right) const;
+
+        // Getters.
+        bool isValid() const { return valid; }
+};
+
+#endif // PEAK_CACHE_H
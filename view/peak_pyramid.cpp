@@ -0,0 +1,158 @@
+#include "peak_pyramid.h"
+#include "../constants.h"
+#include <algorithm>
+
+/*
+ * Sets the number of summarized samples, keeping the existing blocks.
+ */
+void PeakPyramid::resize(size_t count)
+{
+    sampleCount = count;
+    size_t blocks = (count + PEAK_BLOCK_SIZE - 1) / PEAK_BLOCK_SIZE;
+    size_t level = 0;
+
+    while (blocks > 0) {
+        if (level == levels.size()) {
+            levels.emplace_back();
+        }
+
+        levels[level].resize(blocks);
+        level++;
+
+        // The top level is a single block.
+        blocks = blocks > 1 ? (blocks + 1) / 2 : 0;
+    }
+
+    levels.resize(level);
+}
+
+Peak PeakPyramid::merge(const Peak& a, const Peak& b)
+{
+    return {std::min(a.min, b.min), std::max(a.max, b.max), (a.meanSquare + b.meanSquare) * 0.5f};
+}
+
+/*
+ * Summarizes the given number of silent samples.
+ */
+void PeakPyramid::reset(size_t count)
+{
+    levels.clear();
+    resize(count);
+}
+
+/*
+ * Recomputes the blocks covering the [start, end) samples, then the blocks above them.
+ * The count is the total number of samples, which may have changed since the last update
+ * (ie: recording or deleting), in which case all the samples from the change must be updated.
+ */
+void PeakPyramid::update(const SampleReader& read, size_t count, size_t start, size_t end)
+{
+    if (count != sampleCount) {
+        resize(count);
+    }
+
+    end = std::min(end, count);
+
+    if (start >= end) {
+        return;
+    }
+
+    size_t first = start / PEAK_BLOCK_SIZE;
+    size_t last = (end + PEAK_BLOCK_SIZE - 1) / PEAK_BLOCK_SIZE;
+    // Read the samples a few blocks at a time.
+    const size_t blocksPerRead = 256;
+
+    for (size_t block = first; block < last; block += blocksPerRead) {
+        size_t from = block * PEAK_BLOCK_SIZE;
+        size_t length = std::min(std::min(last - block, blocksPerRead) * PEAK_BLOCK_SIZE, count - from);
+        const float* samples = read(from, length);
+
+        for (size_t offset = 0; offset < length; offset += PEAK_BLOCK_SIZE) {
+            size_t n = std::min<size_t>(PEAK_BLOCK_SIZE, length - offset);
+            Peak peak = {samples[offset], samples[offset], 0.0f};
+
+            for (size_t i = offset; i < offset + n; i++) {
+                peak.min = std::min(peak.min, samples[i]);
+                peak.max = std::max(peak.max, samples[i]);
+                peak.meanSquare += samples[i] * samples[i];
+            }
+
+            peak.meanSquare /= static_cast<float>(n);
+            levels[0][block + offset / PEAK_BLOCK_SIZE] = peak;
+        }
+    }
+
+    propagate(first, last);
+}
+
+/*
+ * Recomputes the blocks above the [first, last) blocks of level 0 up to the top level.
+ */
+void PeakPyramid::propagate(size_t first, size_t last)
+{
+    for (size_t level = 1; level < levels.size(); level++) {
+        first /= 2;
+        last = (last + 1) / 2;
+        const std::vector<Peak>& below = levels[level - 1];
+
+        for (size_t i = first; i < last; i++) {
+            levels[level][i] = 2 * i + 1 < below.size() ? merge(below[2 * i], below[2 * i + 1]) : below[2 * i];
+        }
+    }
+}
+
+/*
+ * Rebuilds the pyramid from its level 0 blocks (ie: read from the peak cache).
+ * Returns false if the number of blocks doesn't match the number of samples.
+ */
+bool PeakPyramid::setBaseLevel(size_t count, std::vector<Peak>&& blocks)
+{
+    reset(count);
+
+    if (levels.empty() || blocks.size() != levels[0].size()) {
+        reset(0);
+        return false;
+    }
+
+    levels[0] = std::move(blocks);
+    propagate(0, levels[0].size());
+
+    return true;
+}
+
+/*
+ * Returns the summary of the [start, end) samples from the coarsest level which blocks
+ * are not larger than the range, so that only a few blocks are merged.
+ * Note: Blocks partly outside the range are included.
+ */
+Peak PeakPyramid::query(size_t start, size_t end) const
+{
+    end = std::min(end, sampleCount);
+
+    if (start >= end || levels.empty()) {
+        return Peak();
+    }
+
+    size_t level = 0;
+    size_t blockSize = PEAK_BLOCK_SIZE;
+
+    while (level + 1 < levels.size() && blockSize * 2 <= end - start) {
+        level++;
+        blockSize *= 2;
+    }
+
+    const std::vector<Peak>& blocks = levels[level];
+    size_t first = start / blockSize;
+    size_t last = std::min((end + blockSize - 1) / blockSize, blocks.size());
+    Peak peak = blocks[first];
+
+    for (size_t i = first + 1; i < last; i++) {
+        peak.min = std::min(peak.min, blocks[i].min);
+        peak.max = std::max(peak.max, blocks[i].max);
+        peak.meanSquare += blocks[i].meanSquare;
+    }
+
+    peak.meanSquare /= static_cast<float>(last - first);
+
+    return peak;
+}
@@ -0,0 +1,48 @@
+#ifndef PEAK_PYRAMID_H
+#define PEAK_PYRAMID_H
+
+#include <vector>
+#include <functional>
+#include <cstddef>
+
+/*
+ * Summary of a block of samples.
+ */
+struct Peak {
+    float min = 0.0f;
+    float max = 0.0f;
+    // Mean of the squared samples (ie: the RMS value once square rooted).
+    float meanSquare = 0.0f;
+};
+
+/*
+ * Min/max/RMS summaries of the samples of a channel at power-of-two decimation levels.
+ * Level 0 summarizes blocks of PEAK_BLOCK_SIZE samples, each level above merges
+ * the blocks of the level below two by two. Whatever the zoom, a pixel column
+ * is drawn from a couple of blocks instead of all of its samples.
+ */
+class PeakPyramid {
+    public:
+        // Returns the count samples from start (the returned buffer must hold them all).
+        using SampleReader = std::function<const float*(size_t start, size_t count)>;
+
+    private:
+        std::vector<std::vector<Peak>> levels;
+        size_t sampleCount = 0;
+
+        void resize(size_t count);
+        void propagate(size_t first, size_t last);
+        static Peak merge(const Peak& a, const Peak& b);
+
+    public:
+        void reset(size_t count);
+        void update(const SampleReader& read, size_t count, size_t start, size_t end);
+        Peak query(size_t start, size_t end) const;
+        bool setBaseLevel(size_t count, std::vector<Peak>&& blocks);
+
+        // Getters.
+        size_t getSampleCount() const { return sampleCount; }
+        const std::vector<std::vector<Peak>>& getLevels() const { return levels; }
+};
+
+#endif // PEAK_PYRAMID_H
@@ -1,17 +1,174 @@
+// Vertex buffer functions (OpenGL 1.5).
+#define GL_GLEXT_PROTOTYPES
 #include "../audio/track.h"
+#include <GL/glext.h>
 #include "../main.h"
+#include "peak_cache.h"
 
 
-void Waveform::setStereoSamples(const std::vector<float>& left, const std::vector<float>& right) {
-    leftSamples = left;
-    rightSamples = right;
+/*
+ * Summarizes the whole track samples and fits them to the screen.
+ */
+void Waveform::setSamples() {
+    rebuildPeaks();
+    fitToScreen();
+}
+
+/*
+ * Sets the number of samples being decoded (ie: silent until summarized through pullDecodedSamples).
+ */
+void Waveform::setSampleCount(size_t count) {
+    peaks[0].reset(count);
+    peaks[1].reset(count);
+    peaksFromCache = false;
+    verticesDirty = true;
+
+    fitToScreen();
+}
+
+/*
+ * Summarizes the whole track samples again while keeping the current view (zoom, scroll...).
+ */
+void Waveform::updateSamples() {
+    rebuildPeaks();
+    updateScrollbar();
+    redraw();
+}
+
+/*
+ * Returns the number of samples per channel to draw.
+ */
+size_t Waveform::getSampleCount() const {
+    // The track buffers grow while recording, so only the samples summarized so far are drawn.
+    return track.isRecording() ? peaks[0].getSampleCount() : track.getFrameCount();
+}
+
+/*
+ * Returns the given range of samples of a channel (0 = left, 1 = right),
+ * copied from the track into a scratch buffer.
+ */
+const float* Waveform::getSamples(int channel, size_t start, size_t count) {
+    scratch.resize(count);
+    track.readFrames(start, count, channel == 0 ? scratch.data() : nullptr, channel == 1 ? scratch.data() : nullptr);
+
+    return scratch.data();
+}
+
+/*
+ * Computes the min/max/RMS envelope of each pixel column of a channel (0 = left, 1 = right).
+ */
+const std::vector<Waveform::Envelope>& Waveform::getEnvelopes(int channel) {
+    // Samples haven't been summarized yet (ie: memory mapped file).
+    if (peaks[channel].getSampleCount() != getSampleCount()) {
+        rebuildPeaks();
+    }
+
+    float samplesPerPixel = 1.0f / zoomLevel;
+    size_t totalSamples = getSampleCount();
+    envelopes.resize(w());
+
+    for (int x = 0; x < w(); ++x) {
+        size_t startSample = scrollOffset + static_cast<size_t>(x * samplesPerPixel);
+        size_t endSample = std::min(scrollOffset + static_cast<size_t>((x + 1) * samplesPerPixel), totalSamples);
+        Envelope& envelope = envelopes[x];
+        envelope = {1.0f, -1.0f, 0.0f, true};
+
+        if (startSample >= endSample) {
+            continue;
+        }
+
+        size_t count = endSample - startSample;
+
+        // Columns smaller than a block are computed from the samples (unless they're being recorded).
+        if (count < PEAK_BLOCK_SIZE && !track.isRecording()) {
+            const float* samples = getSamples(channel, startSample, count);
+            float sumSquares = 0.0f;
+
+            for (size_t i = 0; i < count; ++i) {
+                envelope.min = std::min(envelope.min, samples[i]);
+                envelope.max = std::max(envelope.max, samples[i]);
+                sumSquares += samples[i] * samples[i];
+            }
+
+            envelope.rms = std::sqrt(sumSquares / count);
+        }
+        else {
+            Peak peak = peaks[channel].query(startSample, endSample);
+            envelope.min = peak.min;
+            envelope.max = peak.max;
+            envelope.rms = std::sqrt(peak.meanSquare);
+        }
+
+        // Noise threshold
+        envelope.silent = std::max(std::abs(envelope.min), std::abs(envelope.max)) <= 0.005f;
+    }
+
+    return envelopes;
+}
+
+/*
+ * Summarizes all of the samples of both channels.
+ */
+void Waveform::rebuildPeaks() {
+    peaks[0].reset(0);
+    peaks[1].reset(0);
+    peaksFromCache = false;
+    updatePeaks(0, getSampleCount());
+}
+
+/*
+ * Reads the peaks of the track file from the peak cache. Returns false if they haven't
+ * been cached yet or if the file has changed since.
+ */
+bool Waveform::loadPeakCache() {
+    PeakCache cache(track.getFileName(), track.getSampleRate());
+
+    if (!cache.load(peaks[0], peaks[1], getSampleCount())) {
+        return false;
+    }
 
+    peaksFromCache = true;
+    verticesDirty = true;
+    redraw();
+
+    return true;
+}
+
+/*
+ * Writes the peaks of the track file to the peak cache, unless they've been read from it.
+ * Must be called only while the samples are those of the file.
+ */
+void Waveform::savePeakCache() {
+    if (peaksFromCache) {
+        return;
+    }
+
+    PeakCache cache(track.getFileName(), track.getSampleRate());
+    cache.save(peaks[0], peaks[1]);
+}
+
+/*
+ * Updates the summaries of the [start, end) samples after they've been modified.
+ * If the number of samples has changed, end must be the end of the samples.
+ */
+void Waveform::updatePeaks(size_t start, size_t end) {
+    // Recorded samples extend the track.
+    size_t count = track.isRecording() ? std::max(getSampleCount(), end) : getSampleCount();
+    verticesDirty = true;
+
+    for (int channel = 0; channel < 2; channel++) {
+        peaks[channel].update([this, channel](size_t from, size_t length) { return getSamples(channel, from, length); },
+                              count, start, end);
+    }
+}
+
+void Waveform::fitToScreen() {
     isStereo = track.isStereo();
 
     // Fit entire waveform on screen initially.
-    if (!leftSamples.empty()) {
+    if (getSampleCount() > 0) {
         // Compute fit-to-screen zoom (pixels per sample that fits entire file).
-        zoomFit = static_cast<float>(w()) / static_cast<float>(leftSamples.size());
+        zoomFit = static_cast<float>(w()) / static_cast<float>(getSampleCount());
         // Allow zooming out beyond fit-to-screen.
         // Note: Tweak factor (0.01 = 100× smaller than fit).
         zoomMin = zoomFit * 0.01f;
@@ -34,8 +191,8 @@ void Waveform::setStereoSamples(const std::vector<float>& left, const std::vecto
     redraw();
 }
 
-void Waveform::setScrollOffset(int offset) {
-    scrollOffset = std::max(0, offset);
+void Waveform::setScrollOffset(size_t offset) {
+    scrollOffset = offset;
     updateScrollbar();
     redraw();
 }
@@ -46,13 +203,24 @@ void Waveform::setScrollbar(Fl_Scrollbar* sb) {
 }
 
 void Waveform::updateScrollbar() {
-    if (!scrollbar || leftSamples.empty()) return;
-    int visibleSamples = static_cast<int>(w() / zoomLevel);
-    int maxOffset = std::max(0, (int)leftSamples.size() - visibleSamples);
-    scrollOffset = std::clamp(scrollOffset, 0, maxOffset);
+    if (!scrollbar || getSampleCount() == 0) return;
+    size_t visibleSamples = static_cast<size_t>(w() / zoomLevel);
+    size_t maxOffset = getMaxScrollOffset();
+    scrollOffset = std::min(scrollOffset, maxOffset);
     scrollbar->maximum(maxOffset);
-    scrollbar->value(scrollOffset);
-    scrollbar->slider_size((float)visibleSamples / leftSamples.size());
+    // The integer value of the scrollbar would overflow past 2^31 samples.
+    scrollbar->Fl_Valuator::value(static_cast<double>(scrollOffset));
+    scrollbar->slider_size((float)visibleSamples / getSampleCount());
+}
+
+/*
+ * Returns the scroll offset which shows the end of the samples on the right edge.
+ */
+size_t Waveform::getMaxScrollOffset() const {
+    size_t visibleSamples = static_cast<size_t>(w() / zoomLevel);
+    size_t count = getSampleCount();
+
+    return count > visibleSamples ? count - visibleSamples : 0;
 }
 
 void Waveform::prepareForRecording()
@@ -73,56 +241,66 @@ void Waveform::prepareForRecording()
     redraw();
 }
 
-void Waveform::pullNewRecordedSamples()
+/*
+ * Summarizes the samples newly written into the track (ie: recorded).
+ * Returns true if there are new samples.
+ */
+bool Waveform::pullNewSamples()
 {
-    std::vector<float> newLeft, newRight;
     size_t startIndex, count;
 
-    if (track.getNewSamplesCopy(newLeft, newRight, startIndex, count)) {
-        if (count == 0) return;
+    if (!track.getNewSamplesRange(startIndex, count) || count == 0) {
+        return false;
+    }
+
+    updatePeaks(startIndex, startIndex + count);
+    lastSyncedSample = startIndex + count;
 
-        size_t requiredSize = startIndex + count;
+    return true;
+}
 
-        // Ensure we have enough capacity
-        if (leftSamples.size() < requiredSize) {
-            leftSamples.resize(requiredSize, 0.0f);
-            rightSamples.resize(requiredSize, 0.0f);
+/*
+ * Summarizes the samples decoded since the last call (ie: file loading).
+ * Ranges are decoded in parallel, so each one is pulled separately.
+ */
+bool Waveform::pullDecodedSamples()
+{
+    size_t rangeCount = track.getDecodeRangeCount();
+    pulledFrames.resize(rangeCount, 0);
+    bool pulled = false;
+
+    for (size_t i = 0; i < rangeCount; i++) {
+        auto [start, decoded] = track.getDecodedRange(i);
+
+        if (decoded <= pulledFrames[i]) {
+            continue;
         }
 
-        // Append new samples
-        for (size_t i = 0; i < count; i++) {
-            size_t globalIndex = startIndex + i;
-
-            if (globalIndex < leftSamples.size()) {
-                // Shouldn't happen with proper indexing, but safe
-                leftSamples[globalIndex] = newLeft[i];
-                rightSamples[globalIndex] = newRight[i];
-            } else {
-                // Normal case - append
-                leftSamples.push_back(newLeft[i]);
-                rightSamples.push_back(newRight[i]);
-            }
+        // The peaks of the whole file are already known.
+        if (!peaksFromCache) {
+            updatePeaks(start + pulledFrames[i], start + decoded);
         }
 
-        // --- Alternative (without loop nor condition) ---
-        // Copy new samples (overwrite or append)
-        //std::copy_n(newLeft.begin(), count, leftSamples.begin() + startIndex);
-        //std::copy_n(newRight.begin(), count, rightSamples.begin() + startIndex);
+        pulledFrames[i] = decoded;
+        verticesDirty = true;
+        pulled = true;
+    }
 
-        lastSyncedSample = startIndex + count;
+    return pulled;
+}
 
+void Waveform::pullNewRecordedSamples()
+{
+    if (pullNewSamples()) {
         // ===== Rolling window style  ====
-        int head = static_cast<int>(leftSamples.size());
-        int visible = visibleSamplesCount();
-        int rightEdge = scrollOffset + visible;
+        size_t head = getSampleCount();
+        size_t visible = visibleSamplesCount();
+        size_t rightEdge = scrollOffset + visible;
 
         // Scroll only when the record head nears the right edge
-        if (head > rightEdge - visible / 10) {
-            scrollOffset = head - (int)(visible * 0.9f);
-
-            if (scrollOffset < 0) { 
-                scrollOffset = 0;
-            }
+        if (head + visible / 10 > rightEdge) {
+            size_t lead = static_cast<size_t>(visible * 0.9f);
+            scrollOffset = head > lead ? head - lead : 0;
         }
         // =====================
 
@@ -135,7 +313,7 @@ void Waveform::pullNewRecordedSamples()
  * Check whether a selection is currently set.
  */
 bool Waveform::selection() {
-    if (selectionStartSample >= 0 && selectionEndSample >= 0 && selectionStartSample != selectionEndSample) {
+    if (selectionStartSample != selectionEndSample) {
         return true;
     }
 
@@ -147,12 +325,150 @@ bool Waveform::selection() {
  */
 float Waveform::getLastDrawnX() 
 {
-    int totalSamples = leftSamples.size();
-    int visibleSamples = visibleSamplesCount();
-    int endSample = scrollOffset + visibleSamples;
+    size_t endSample = scrollOffset + visibleSamplesCount();
 
     // Compute and return last drawn x position.
-    return (float)(std::min(endSample, totalSamples) - scrollOffset) * zoomLevel;
+    return getSampleX(std::min(endSample, getSampleCount()));
+}
+
+/*
+ * Computes the x position of the given sample in the view (negative if it's on the left of the view).
+ * The difference is taken in double precision as positions can go beyond the 24 bits of a float.
+ */
+float Waveform::getSampleX(size_t sample) const
+{
+    return static_cast<float>((static_cast<double>(sample) - static_cast<double>(scrollOffset)) * zoomLevel);
+}
+
+/*
+ * Computes the sample under the given x position in the view.
+ */
+size_t Waveform::getSampleAt(int x) const
+{
+    return scrollOffset + static_cast<size_t>(std::max(0, x) / zoomLevel);
+}
+
+/*
+ * Generates the vertices of a channel (0 = left, 1 = right) for the current view and uploads them
+ * to its vertex buffer. X is in pixels and Y is the sample amplitude, scaled when drawn.
+ */
+void Waveform::buildVertexBuffer(int channel) {
+    VertexBuffer& buffer = vertexBuffers[channel];
+    buffer.envelopeCount = buffer.rmsCount = buffer.stripCount = 0;
+    vertices.clear();
+
+    auto addVertex = [this](float x, float y) {
+        vertices.push_back(x);
+        vertices.push_back(std::clamp(y, -1.0f, 1.0f));
+    };
+
+    float samplesPerPixel = 1.0f / zoomLevel;
+
+    // Decide rendering mode based on zoom level.
+    // Note: Samples being recorded are only drawn from their summaries.
+    if (samplesPerPixel > 5.0f || track.isRecording()) {
+        // ZOOMED OUT: Envelope (min/max per pixel column)
+        const std::vector<Envelope>& envelopes = getEnvelopes(channel);
+
+        for (int x = 0; x < (int)envelopes.size(); ++x) {
+            float minY = envelopes[x].min;
+            float maxY = envelopes[x].max;
+
+            if (envelopes[x].silent) {
+                // Flat silent section → 1-pixel wide horizontal line at amplitude 0.
+                addVertex(x, 0.0f);
+                addVertex(x + 1, 0.0f);
+                continue;
+            }
+
+            // Avoid disappearing lines: pad very flat sections
+            // Note: Near-flat, but not completely silent → pad it
+            if (std::abs(maxY - minY) < 0.01f) {
+                minY -= 0.005f; maxY += 0.005f;
+            }
+
+            addVertex(x, minY);
+            addVertex(x, maxY);
+        }
+
+        buffer.envelopeCount = vertices.size() / 2;
+
+        // RMS band over the envelope.
+        for (int x = 0; x < (int)envelopes.size(); ++x) {
+            if (!envelopes[x].silent) {
+                addVertex(x, std::max(-envelopes[x].rms, envelopes[x].min));
+                addVertex(x, std::min(envelopes[x].rms, envelopes[x].max));
+            }
+        }
+
+        buffer.rmsCount = vertices.size() / 2 - buffer.envelopeCount;
+    }
+    else {
+        // ZOOMED IN: One sample per vertex, smooth line.
+        // Note: Add +1 sample to visible range to ensure last visible pixel is drawn.
+        size_t visibleSamples = static_cast<size_t>(std::ceil(w() / zoomLevel)) + 1;
+        size_t endSample = std::min(scrollOffset + visibleSamples, getSampleCount());
+        size_t count = endSample > scrollOffset ? endSample - scrollOffset : 0;
+        const float* samples = getSamples(channel, scrollOffset, count);
+
+        for (size_t i = 0; i < count; ++i) {
+            addVertex(i * zoomLevel, samples[i]);
+        }
+
+        buffer.stripCount = vertices.size() / 2;
+    }
+
+    if (buffer.id == 0) {
+        glGenBuffers(1, &buffer.id);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, buffer.id);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/*
+ * Draws the vertex buffer of a channel in the given area.
+ */
+void Waveform::drawVertexBuffer(int channel, int yOffset, int heightPx) {
+    const VertexBuffer& buffer = vertexBuffers[channel];
+
+    if (buffer.id == 0) {
+        return;
+    }
+
+    // Map the amplitudes [1, -1] to the channel area.
+    glPushMatrix();
+    glTranslatef(0.0f, yOffset + heightPx / 2.0f, 0.0f);
+    glScalef(1.0f, -heightPx / 2.0f, 1.0f);
+
+    glBindBuffer(GL_ARRAY_BUFFER, buffer.id);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 0, nullptr);
+
+    if (buffer.envelopeCount > 0) {
+        glDrawArrays(GL_LINES, 0, buffer.envelopeCount);
+        // Light blue RMS band.
+        glColor3f(0.4f, 0.4f, 1.0f);
+        glDrawArrays(GL_LINES, buffer.envelopeCount, buffer.rmsCount);
+    }
+    else {
+        glDrawArrays(GL_LINE_STRIP, 0, buffer.stripCount);
+
+        // --- Draw nodes if zoomed in enough ---
+        if (1.0f / zoomLevel <= 0.1f) {
+            glColor3f(1.0f, 0.0f, 0.0f); // red nodes
+            glPointSize(4.0f);           // size of each node
+            glDrawArrays(GL_POINTS, 0, buffer.stripCount);
+        }
+    }
+
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glPopMatrix();
+
+    // Waveform color (blue).
+    glColor3f(0.0f, 0.0f, 1.0f);
 }
 
 void Waveform::draw() {
@@ -170,102 +486,35 @@ void Waveform::draw() {
     glClearColor(1, 1, 1, 1);
     glClear(GL_COLOR_BUFFER_BIT);
 
-    if (leftSamples.empty()) return;
+    if (getSampleCount() == 0) return;
 
     // Blue waveform.
     glColor3f(0.0f, 0.0f, 1.0f);
     // Ensure full-pixel lines.
     glLineWidth(1.0f);
 
-    // Lambda function that draws a channel.
-    auto drawChannel = [&](const std::vector<float>& channel, int yOffset, int heightPx) {
-        float samplesPerPixel = 1.0f / zoomLevel;
-
-        // Decide rendering mode based on zoom level.
-        if (samplesPerPixel > 5.0f) {
-            // ZOOMED OUT: Envelope (min/max per pixel column)
-            glBegin(GL_LINES);
-
-            for (int x = 0; x < w(); ++x) {
-                int startSample = scrollOffset + static_cast<int>(x * samplesPerPixel);
-                int endSample = std::min(scrollOffset + static_cast<int>((x + 1) * samplesPerPixel), (int)channel.size());
-
-                float minY = 1.0f, maxY = -1.0f;
-                for (int i = startSample; i < endSample; ++i) {
-                    float s = channel[i];
-                    minY = std::min(minY, s);
-                    maxY = std::max(maxY, s);
-                }
-
-                bool isSilent = true;
-
-                for (int i = startSample; i < endSample; ++i) {
-                    // Noise threshold
-                    if (std::abs(channel[i]) > 0.005f) {
-                        isSilent = false;
-                        break;
-                    }
-                }
-
-                if (isSilent) {
-                    // Flat silent section → draw a thin horizontal line
-                    float yFlatPx = yOffset + (1.0f - 0.0f) * (heightPx / 2.0f);  // Amplitude 0
-
-                    glVertex2f(x, yFlatPx);
-                    // 1-pixel wide horizontal line.
-                    glVertex2f(x + 1, yFlatPx);
-                    // Skip the rest of loop.
-                    continue;
-                }
-
-                // Avoid disappearing lines: pad very flat sections
-                // Note: Near-flat, but not completely silent → pad it
-                if (std::abs(maxY - minY) < 0.01f) {
-                    minY -= 0.005f; maxY += 0.005f;
-                }
-
-                float yMinPx = yOffset + (1.0f - std::clamp(minY, -1.0f, 1.0f)) * (heightPx / 2.0f);
-                float yMaxPx = yOffset + (1.0f - std::clamp(maxY, -1.0f, 1.0f)) * (heightPx / 2.0f);
-
-                glVertex2f(x, yMinPx);
-                glVertex2f(x, yMaxPx);
-            }
-            glEnd();
+    // The context has been (re)created, so are the vertex buffers.
+    if (!context_valid()) {
+        for (auto& buffer : vertexBuffers) {
+            buffer = VertexBuffer();
         }
-        else {
-            // ZOOMED IN: One sample per vertex, smooth line.
-            glBegin(GL_LINE_STRIP);
-
-            // Note: Add +1 sample to visible range to ensure last visible pixel is drawn.
-            int visibleSamples = static_cast<int>(std::ceil(w() / zoomLevel)) + 1;
-            int endSample = std::min(scrollOffset + visibleSamples, (int)channel.size());
-
-            for (int i = scrollOffset; i < endSample; ++i) {
-                float x = (i - scrollOffset) * zoomLevel;
-                float y = yOffset + (1.0f - std::clamp(channel[i], -1.0f, 1.0f)) * (heightPx / 2.0f);
-                glVertex2f(x, y);
-            }
-
-            glEnd();
-
-            // --- Draw nodes if zoomed in enough ---
-            float samplesPerPixel = 1.0f / zoomLevel;
-
-            if (samplesPerPixel <= 0.1f) {
-                glColor3f(1.0f, 0.0f, 0.0f); // red nodes
-                glPointSize(4.0f);           // size of each node
-                glBegin(GL_POINTS);
+    }
 
-                for (int i = scrollOffset; i < endSample; ++i) {
-                    float x = (i - scrollOffset) * zoomLevel;
-                    float y = yOffset + (1.0f - std::clamp(channel[i], -1.0f, 1.0f)) * (heightPx / 2.0f);
-                    glVertex2f(x, y);
-                }
+    // Vertices are only generated again when the view or the samples change.
+    if (verticesDirty || builtScrollOffset != scrollOffset || builtZoomLevel != zoomLevel ||
+        builtWidth != w() || builtStereo != isStereo || vertexBuffers[0].id == 0) {
+        buildVertexBuffer(0);
 
-                glEnd();
-            }
+        if (isStereo) {
+            buildVertexBuffer(1);
         }
-    };
+
+        builtScrollOffset = scrollOffset;
+        builtZoomLevel = zoomLevel;
+        builtWidth = w();
+        builtStereo = isStereo;
+        verticesDirty = false;
+    }
 
     // If waveform doesn't fill the full width, paint the rest in grey
     float lastX = getLastDrawnX();
@@ -287,12 +536,12 @@ void Waveform::draw() {
 
     // --- Draw current selection (if any) ---
     if (selection() || (isSelecting && !track.isPlaying() && !track.isRecording())) {
-        int x1 = (std::min(selectionStartSample, selectionEndSample) - scrollOffset) * zoomLevel;
-        int x2 = (std::max(selectionStartSample, selectionEndSample) - scrollOffset) * zoomLevel;
+        float x1 = getSampleX(std::min(selectionStartSample, selectionEndSample));
+        float x2 = getSampleX(std::max(selectionStartSample, selectionEndSample));
 
         // Clamp to visible area
-        x1 = std::clamp(x1, 0, w());
-        x2 = std::clamp(x2, 0, w());
+        x1 = std::clamp(x1, 0.0f, (float)w());
+        x2 = std::clamp(x2, 0.0f, (float)w());
 
         glColor3f(0.0f, 0.0f, 0.0f); // black
         glBegin(GL_QUADS);
@@ -308,8 +557,8 @@ void Waveform::draw() {
 
     if (isStereo) {
         // Draw both left and right channels.
-        drawChannel(leftSamples, 0, halfHeight);
-        drawChannel(rightSamples, halfHeight, halfHeight);
+        drawVertexBuffer(0, 0, halfHeight);
+        drawVertexBuffer(1, halfHeight, halfHeight);
 
         // --- Draw separation line between waveforms ---
 
@@ -339,7 +588,7 @@ void Waveform::draw() {
     }
     // mono = full height
     else {
-        drawChannel(leftSamples, 0, h());
+        drawVertexBuffer(0, 0, h());
         // --- Draw zero line (middle line). ---
         glColor3f(0.863f, 0.863f, 0.863f);
         glBegin(GL_LINES);
@@ -351,7 +600,7 @@ void Waveform::draw() {
 
 
     // --- Draw playback cursor ---
-    int sampleToDraw = -1;
+    size_t sampleToDraw = 0;
 
     if (track.isRecording()) {
         sampleToDraw = track.getCaptureWriteIndex();
@@ -362,26 +611,23 @@ void Waveform::draw() {
         sampleToDraw = cursorSamplePosition;
     }
 
-    if (sampleToDraw >= 0) {
-        int visibleStart = scrollOffset;
-        int visibleEnd = scrollOffset + static_cast<int>(std::ceil(w() / zoomLevel));
+    size_t visibleStart = scrollOffset;
+    size_t visibleEnd = scrollOffset + static_cast<size_t>(std::ceil(w() / zoomLevel));
 
-        if (sampleToDraw >= visibleStart && sampleToDraw < visibleEnd) {
-            float x = (sampleToDraw - scrollOffset) * zoomLevel;
-            glColor3f(1.0f, 0.0f, 0.0f);
-            glLineWidth(1.0f);
-            glBegin(GL_LINES);
-            glVertex2f(x, 0);
-            glVertex2f(x, h());
+    if (sampleToDraw >= visibleStart && sampleToDraw < visibleEnd) {
+        float x = getSampleX(sampleToDraw);
+        glColor3f(1.0f, 0.0f, 0.0f);
+        glLineWidth(1.0f);
+        glBegin(GL_LINES);
+        glVertex2f(x, 0);
+        glVertex2f(x, h());
 
-            glEnd();
-        }
+        glEnd();
     }
 
     // --- Draw markers (if any) ---
     for (size_t i = 0; i < marking.getMarkers().size(); i++) {
-        sampleToDraw = marking.getMarkers()[i]->getSamplePosition();
-        float x = (sampleToDraw - scrollOffset) * zoomLevel;
+        float x = getSampleX(marking.getMarkers()[i]->getSamplePosition());
 
         if (!marking.getMarkers()[i]->isDragging()) {
             // Realign marker's label horizontally up in the marking area.
@@ -417,9 +663,7 @@ int Waveform::handle(int event) {
 
             zoomLevel = std::clamp(zoomLevel, zoomMin, zoomMax);
 
-            int visibleSamples = static_cast<int>(w() / zoomLevel);
-            int maxOffset = std::max(0, (int)leftSamples.size() - visibleSamples);
-            scrollOffset = std::clamp(scrollOffset, 0, maxOffset);
+            scrollOffset = std::min(scrollOffset, getMaxScrollOffset());
 
             updateScrollbar();
             redraw();
@@ -435,11 +679,10 @@ int Waveform::handle(int event) {
                     Fl_Widget::take_focus();
                 }
 
-                int mouseX = Fl::event_x();
-                int sample = scrollOffset + static_cast<int>(mouseX / zoomLevel);
+                size_t sample = getSampleAt(Fl::event_x());
 
                 // Clamp within sample range
-                sample = std::clamp(sample, 0, (int)leftSamples.size() - 1);
+                sample = std::min(sample, std::max<size_t>(getSampleCount(), 1) - 1);
 
                 initialSamplePosition = sample;
                 cursorSamplePosition = sample;
@@ -475,9 +718,7 @@ int Waveform::handle(int event) {
                     // Check for selection reversing.
                     if (selectionEndSample < selectionStartSample) {
                         // Swap values.
-                        int tmp = selectionStartSample;
-                        selectionStartSample = selectionEndSample;
-                        selectionEndSample = tmp;
+                        std::swap(selectionStartSample, selectionEndSample);
                     }
 
                     // Always placing the cursor at the start of the selection.
@@ -499,10 +740,9 @@ int Waveform::handle(int event) {
         case FL_DRAG: {
             if (Fl::event_button() == FL_LEFT_MOUSE && isSelecting) {
                 // Draw the selection range.
-                int mouseX = Fl::event_x();
-                int sample = scrollOffset + static_cast<int>(mouseX / zoomLevel);
+                size_t sample = getSampleAt(Fl::event_x());
                 // Clamp within sample range
-                sample = std::clamp(sample, 0, (int)leftSamples.size() - 1);
+                sample = std::min(sample, std::max<size_t>(getSampleCount(), 1) - 1);
 
                 // Check for selection.
                 if (selectionHandle == Direction::LEFT) {
@@ -523,15 +763,14 @@ int Waveform::handle(int event) {
 
         case FL_MOVE: {
             if (selection()) {
-                int mouseX = Fl::event_x();
-                int sample = scrollOffset + static_cast<int>(mouseX / zoomLevel);
+                float mouseX = Fl::event_x();
 
                 // Check if mouse is near selection boundaries (with some tolerance).
 
                 // Pixels tolerance.
                 int tolerance = 3; 
-                bool nearStart = abs(sample - selectionStartSample) * zoomLevel < tolerance;
-                bool nearEnd = abs(sample - selectionEndSample) * zoomLevel < tolerance;
+                bool nearStart = std::abs(mouseX - getSampleX(selectionStartSample)) < tolerance;
+                bool nearEnd = std::abs(mouseX - getSampleX(selectionEndSample)) < tolerance;
 
                 // The mouse is over the left selection boundaries.
                 if (nearStart) {
@@ -593,8 +832,8 @@ int Waveform::handle(int event) {
                 // Process only when playback is stopped.
                 if (!track.isPlaying()) {
                     // Set positions to the end.
-                    cursorSamplePosition = static_cast<int>(leftSamples.size()) - 1;
-                    initialSamplePosition = static_cast<int>(leftSamples.size()) - 1;
+                    cursorSamplePosition = std::max<size_t>(getSampleCount(), 1) - 1;
+                    initialSamplePosition = cursorSamplePosition;
                     resetCursor();
 
                     return 1;
@@ -615,18 +854,18 @@ int Waveform::handle(int event) {
 void Waveform::resetCursor()
 {
     // Get the cursor's initial position.
-    int resetTo = initialSamplePosition;
+    size_t resetTo = initialSamplePosition;
     // Reset the cursor to its initial audio position.
     track.setPlaybackSampleIndex(resetTo);
 
     // Compute a target offset before the cursor, (e.g: show 10% of the window before the cursor.)
     float zoom = getZoomLevel();
     // Number of samples that fit in the view
-    int visibleSamples = static_cast<int>(w() / zoom);
+    size_t visibleSamples = static_cast<size_t>(w() / zoom);
     // Shift back by a percentage of visible samples (e.g., 10%)
-    int marginSamples = static_cast<int>(visibleSamples * 0.1f);
+    size_t marginSamples = static_cast<size_t>(visibleSamples * 0.1f);
     // Compute the new scroll offset
-    int newScrollOffset = std::max(0, resetTo - marginSamples);
+    size_t newScrollOffset = resetTo > marginSamples ? resetTo - marginSamples : 0;
     // Apply it.
     setScrollOffset(newScrollOffset);
     // Force the waveform (and cursor) to repaint
@@ -638,9 +877,11 @@ void Waveform::update_cursor_timer_cb(void* userdata) {
     auto& track = *(Track*)userdata;  // Dereference to get reference
     auto& waveform = track.getWaveform();
     // Reads from atomic.
-    int sample = track.getCurrentSample();
+    size_t sample = track.getCurrentSample();
     // Synchronize view with audio. 
     waveform.setCursorSamplePosition(sample);
+    // The selection may have changed during playback.
+    track.updatePlaybackRange();
 
     // --- Smart auto-scroll ---
     // Auto-scroll the view if cursor gets near right edge
@@ -649,15 +890,15 @@ void Waveform::update_cursor_timer_cb(void* userdata) {
     int margin = 30;
     float zoom = waveform.getZoomLevel();
     int viewWidth = waveform.w();
-    int cursorX = static_cast<int>((sample - waveform.getScrollOffset()) * zoom);
+    float cursorX = waveform.getSampleX(sample);
 
     if (cursorX > viewWidth - margin) {
-        int newOffset = sample - static_cast<int>((viewWidth - margin) / zoom);
-        waveform.setScrollOffset(newOffset);
+        size_t lead = static_cast<size_t>((viewWidth - margin) / zoom);
+        waveform.setScrollOffset(sample > lead ? sample - lead : 0);
     }
 
     // Assuming left and right channels are the same length.
-    int totalSamples = static_cast<int>(track.getLeftSamples().size());
+    size_t totalSamples = track.getFrameCount();
 
     waveform.redraw();
 
@@ -668,12 +909,12 @@ void Waveform::update_cursor_timer_cb(void* userdata) {
 }
 
 // helper to compute how many samples fit inside the widget width at current zoom
-int Waveform::visibleSamplesCount() const {
-    if (zoomLevel <= 0.0f) return (int)leftSamples.size();
+size_t Waveform::visibleSamplesCount() const {
+    if (zoomLevel <= 0.0f) return getSampleCount();
     // number of samples that correspond to the width: ceil(w / zoomLevel)
-    int vs = static_cast<int>(std::ceil(static_cast<float>(w()) / zoomLevel));
-    vs = std::max(1, vs);
-    vs = std::min((int)leftSamples.size(), vs);
+    size_t vs = static_cast<size_t>(std::ceil(static_cast<float>(w()) / zoomLevel));
+    vs = std::max<size_t>(1, vs);
+    vs = std::min(getSampleCount(), vs);
 
     return vs;
 }
@@ -682,6 +923,8 @@ void Waveform::liveUpdate_cb(void* userdata)
 {
     Waveform* self = static_cast<Waveform*>(userdata);
     self->pullNewRecordedSamples();
+    // The summarized samples of a take streamed to disk don't have to stay in memory.
+    self->track.releaseRecordedFrames();
     self->redraw();
 
     if (self->isLiveUpdating) {
@@ -10,6 +10,7 @@
 #include <cmath>
 #include <iostream>
 #include "../constants.h"
+#include "peak_pyramid.h"
 #include "../marking/marking.h"
 
 // Forward declarations.
@@ -17,8 +18,38 @@ class Track;
 class Marking;
 
 class Waveform : public Fl_Gl_Window {
-        std::vector<float> leftSamples;
-        std::vector<float> rightSamples;
+        // Vertices of a channel (envelope + RMS lines when zoomed out, line strip when zoomed in).
+        struct VertexBuffer {
+            GLuint id = 0;
+            GLsizei envelopeCount = 0;
+            GLsizei rmsCount = 0;
+            GLsizei stripCount = 0;
+        };
+
+        // Min/max/RMS values of the samples drawn in a pixel column.
+        struct Envelope {
+            float min, max, rms;
+            bool silent;
+        };
+
+        // Used to copy the samples to draw from the track.
+        std::vector<float> scratch;
+        std::vector<Envelope> envelopes;
+        // Left and right channel summaries.
+        PeakPyramid peaks[2];
+        // The peaks have been read from the peak cache.
+        bool peaksFromCache = false;
+        VertexBuffer vertexBuffers[2];
+        std::vector<float> vertices;
+        // View the vertex buffers have been built for.
+        size_t builtScrollOffset = SIZE_MAX;
+        float builtZoomLevel = 0.0f;
+        int builtWidth = 0;
+        bool builtStereo = true;
+        // Samples have changed since the vertex buffers have been built.
+        bool verticesDirty = true;
+        // Frames already summarized from each decoded range of the track.
+        std::vector<size_t> pulledFrames;
         Fl_Scrollbar* scrollbar = nullptr;
         // Fit-to-screen (current starting zoom).
         float zoomFit = 1.0f;
@@ -28,26 +59,33 @@ class Waveform : public Fl_Gl_Window {
         float zoomMax = 10.0f;
         // Pixels per sample.
         float zoomLevel = 1.0f;
-        int scrollOffset = 0;
+        size_t scrollOffset = 0;
         bool isStereo = true;
         // Current position of the cursor. It can be manually moved.
-        int cursorSamplePosition = 0;
+        size_t cursorSamplePosition = 0;
         // Inintial position of the cursor.
-        int initialSamplePosition = 0;
-        int lastSyncedSample = 0;
-        int recordingStartSample = 0;
+        size_t initialSamplePosition = 0;
+        size_t lastSyncedSample = 0;
+        size_t recordingStartSample = 0;
         Track& track;
         Marking& marking;
-        int visibleSamplesCount() const;
+        size_t visibleSamplesCount() const;
+        size_t getMaxScrollOffset() const;
         bool isLiveUpdating = false;
         bool isSelecting = false;
         Direction selectionHandle = Direction::NONE;
-        int selectionStartSample = -1;
-        int selectionEndSample = -1;
+        // No selection as long as both ends are the same.
+        size_t selectionStartSample = 0;
+        size_t selectionEndSample = 0;
 
         static void liveUpdate_cb(void* userdata);
         void prepareForRecording();
         void pullNewRecordedSamples();
+        size_t getSampleCount() const;
+        const float* getSamples(int channel, size_t start, size_t count);
+        const std::vector<Envelope>& getEnvelopes(int channel);
+        void buildVertexBuffer(int channel);
+        void drawVertexBuffer(int channel, int yOffset, int heightPx);
 
     protected:
         void draw() override;
@@ -61,7 +99,7 @@ class Waveform : public Fl_Gl_Window {
             marking.init(this);
         }
 
-        std::function<void(int)> onSeekCallback;
+        std::function<void(size_t)> onSeekCallback;
         static void update_cursor_timer_cb(void* userdata);
 
         void updateScrollbar();
@@ -69,28 +107,37 @@ class Waveform : public Fl_Gl_Window {
         void startLiveUpdate();
         void stopLiveUpdate();
         bool selection();
+        bool pullNewSamples();
+        bool pullDecodedSamples();
+        void updatePeaks(size_t start, size_t end);
+        void rebuildPeaks();
+        bool loadPeakCache();
+        void savePeakCache();
+        void fitToScreen();
 
         // Getters.
 
-        int getScrollOffset() const { return scrollOffset; }
+        size_t getScrollOffset() const { return scrollOffset; }
         float getZoomLevel() const { return zoomLevel; }
         Track& getTrack() { return track; }
-        int getSelectionStartSample() const { return selectionStartSample; }
-        int getSelectionEndSample() const { return selectionEndSample; }
-        int getCursorSamplePosition() const { return cursorSamplePosition; }
+        size_t getSelectionStartSample() const { return selectionStartSample; }
+        size_t getSelectionEndSample() const { return selectionEndSample; }
+        size_t getCursorSamplePosition() const { return cursorSamplePosition; }
         float getLastDrawnX();
-        std::vector<float>& getLeftSamples() { return leftSamples; }
-        std::vector<float>& getRightSamples() { return rightSamples; }
+        float getSampleX(size_t sample) const;
+        size_t getSampleAt(int x) const;
 
         // Setters.
 
-        void setStereoSamples(const std::vector<float>& left, const std::vector<float>& right);
-        void setScrollOffset(int offset);
+        void setSamples();
+        void setSampleCount(size_t count);
+        void updateSamples();
+        void setScrollOffset(size_t offset);
         void setScrollbar(Fl_Scrollbar* sb);
-        void setCursorSamplePosition(int sample) { cursorSamplePosition = sample; }
+        void setCursorSamplePosition(size_t sample) { cursorSamplePosition = sample; }
         void setStereoMode(bool stereo) { isStereo = stereo; }
-        void setSelectionStartSample(int start) { selectionStartSample = start; }
-        void setSelectionEndSample(int end) { selectionEndSample = end; }
+        void setSelectionStartSample(size_t start) { selectionStartSample = start; }
+        void setSelectionEndSample(size_t end) { selectionEndSample = end; }
 };
 
 #endif // WAVEFORM_H